@@ -0,0 +1,56 @@
+#include "async_log.hpp"
+
+using namespace std;
+
+AsyncLog::AsyncLog(ostream& out, size_t capacity)
+	: out_(out), capacity_(capacity) {
+	pending_.reserve(capacity_);
+	writer_ = thread(&AsyncLog::run, this);
+}
+
+AsyncLog::~AsyncLog() {
+	{
+		lock_guard<mutex> lk(m_);
+		stop_ = true;
+	}
+	cv_.notify_one();
+	writer_.join();
+}
+
+void AsyncLog::line(string text) {
+	{
+		lock_guard<mutex> lk(m_);
+		if (pending_.size() >= capacity_) {
+			++dropped_;
+			return;
+		}
+		pending_.push_back(move(text));
+	}
+	cv_.notify_one();
+}
+
+uint64_t AsyncLog::dropped() const {
+	lock_guard<mutex> lk(m_);
+	return dropped_;
+}
+
+void AsyncLog::run() {
+	vector<string> batch;
+	batch.reserve(capacity_);
+	unique_lock<mutex> lk(m_);
+	while (true) {
+		cv_.wait(lk, [this]() { return stop_ || !pending_.empty(); });
+		if (pending_.empty() && stop_) {
+			break;
+		}
+		// swap, so writers only wait for the swap and not for the stream
+		batch.swap(pending_);
+		lk.unlock();
+		for (const string& s : batch) {
+			out_ << s << '\n';
+		}
+		out_.flush();
+		batch.clear();
+		lk.lock();
+	}
+}
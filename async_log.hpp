@@ -0,0 +1,43 @@
+#ifndef ASYNC_LOG_HPP
+#define ASYNC_LOG_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * Line log written by its own thread, so threads with a frame deadline
+ * only append to a buffer: no formatting into the stream, no flush.
+ * Lines beyond `capacity` pending ones are dropped and counted.
+ */
+class AsyncLog {
+public:
+	explicit AsyncLog(std::ostream& out, size_t capacity = 1024);
+	// writes what is still pending
+	~AsyncLog();
+
+	AsyncLog(const AsyncLog&) = delete;
+	AsyncLog& operator=(const AsyncLog&) = delete;
+
+	void line(std::string text);
+
+	uint64_t dropped() const;
+
+private:
+	void run();
+
+	std::ostream& out_;
+	size_t capacity_;
+	mutable std::mutex m_;
+	std::condition_variable cv_;
+	std::vector<std::string> pending_;
+	uint64_t dropped_ = 0;
+	bool stop_ = false;
+	std::thread writer_;
+};
+
+#endif
@@ -0,0 +1,343 @@
+#include "batch_render.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+
+#include "cpu_render.hpp"
+
+using namespace std;
+
+// the interactive animation at 60 frames/s, 0.01 per frame; with steps,
+// x is where the steps start: the previous frame's value
+static float frame_x(uint64_t n, int steps) {
+	return float(fmod(n * 0.01 + (steps > 1 ? 0.99 : 0.0), 1.0));
+}
+
+static float frame_dx(int steps) {
+	return 0.01f / steps;
+}
+
+// --validate input: every byte value, in a size that isn't the frame's
+static vector<unsigned char> test_pattern(int width, int height) {
+	vector<unsigned char> rgba(size_t(width) * height * 4);
+	unsigned char* p = rgba.data();
+	for (int y = 0; y < height; ++y) {
+		for (int x = 0; x < width; ++x, p += 4) {
+			p[0] = (unsigned char)(x * 7 + y);
+			p[1] = (unsigned char)(y * 5);
+			p[2] = (unsigned char)(x ^ y);
+			p[3] = (unsigned char)(255 - x);
+		}
+	}
+	return rgba;
+}
+
+/*
+ * --validate: compares every frame with CpuRenderer's, which has to be
+ * exact. Frames arrive in order, so the reference glk_steps state
+ * follows along. src is the kernel's input frame, or null.
+ */
+class ReferenceCheck : public FrameSink {
+public:
+	ReferenceCheck(int width, int height, int steps,
+			const unsigned char* src, int srcWidth, int srcHeight)
+		: cpu_(tasks_, width, height), steps_(steps), src_(src),
+		srcWidth_(srcWidth), srcHeight_(srcHeight),
+		expected_(size_t(width) * height * 4) {}
+
+	void write(const unsigned char* rgba, uint64_t frame) override {
+		size_t stride = size_t(cpu_.width()) * 4;
+		if (steps_ > 1) {
+			cpu_.renderSteps(expected_.data(), stride,
+					frame_x(frame, steps_), frame_dx(steps_), steps_,
+					src_, srcWidth_, srcHeight_);
+		} else {
+			cpu_.render(expected_.data(), stride, frame_x(frame, steps_),
+					src_, srcWidth_, srcHeight_);
+		}
+		bool mismatch = false;
+		for (size_t i = 0; i < expected_.size(); ++i) {
+			int d = abs(int(rgba[i]) - int(expected_[i]));
+			if (d > 0) {
+				maxDiff_ = max(maxDiff_, d);
+				mismatch = true;
+				++differing_;
+			}
+		}
+		if (mismatch) {
+			++framesDiffering_;
+		}
+		++frames_;
+	}
+
+	bool passed() const { return maxDiff_ == 0; }
+
+	void report() const {
+		cout << "Validate" << (src_ ? " (input)" : "") << ": "
+			<< frames_ << " frames, " << framesDiffering_
+			<< " differing, " << differing_ << " channels differing, "
+			<< "max difference " << maxDiff_ << " - "
+			<< (passed() ? "PASS" : "FAIL") << endl;
+	}
+
+private:
+	TaskScheduler tasks_;
+	CpuRenderer cpu_;
+	int steps_;
+	const unsigned char* src_;
+	int srcWidth_, srcHeight_;
+	vector<unsigned char> expected_;
+	uint64_t frames_ = 0;
+	uint64_t framesDiffering_ = 0;
+	uint64_t differing_ = 0;
+	int maxDiff_ = 0;
+};
+
+BatchRenderer::BatchRenderer(ClArena& arena, const cl::Device& device,
+		const cl::Kernel& kernel, int width, int height, int inFlight,
+		int steps)
+	: arena_(arena), kernel_(kernel), width_(width), height_(height),
+	steps_(steps), slots_(inFlight) {
+	size_t frameSize = size_t(width_) * height_ * 4;
+	cl::ImageFormat format(CL_RGBA, CL_UNORM_INT8);
+	for (Slot& s : slots_) {
+		// profiled for --bench's kernel time
+		s.queue = cl::CommandQueue(arena_.context(), device,
+				CL_QUEUE_PROFILING_ENABLE);
+		s.image = arena_.image(format, width_, height_, CL_MEM_WRITE_ONLY);
+		s.staging = arena_.staging(frameSize);
+	}
+	if (steps_ > 1) {
+		size_t size = size_t(width_) * height_ * sizeof(cl_float4);
+		state_ = arena_.buffer(size, CL_MEM_READ_WRITE);
+		cl::Event filled;
+		slots_[0].queue.enqueueFillBuffer(state_, 0.f, 0, size, NULL,
+				&filled);
+		lastKernel_ = filled;
+	}
+}
+
+BatchRenderer::~BatchRenderer() {
+	for (Slot& s : slots_) {
+		s.queue.finish();
+		arena_.recycle(s.image);
+		arena_.recycle(s.staging);
+	}
+	if (state_()) {
+		arena_.recycle(state_);
+	}
+	if (src_()) {
+		arena_.recycle(src_);
+	}
+}
+
+void BatchRenderer::setInput(const unsigned char* rgba, int width,
+		int height) {
+	size_t size = size_t(width) * height * 4;
+	src_ = arena_.buffer(size, CL_MEM_READ_ONLY);
+	slots_[0].queue.enqueueWriteBuffer(src_, CL_TRUE, 0, size, rgba);
+	srcWidth_ = width;
+	srcHeight_ = height;
+}
+
+void BatchRenderer::finish(Slot& slot, FrameSink* sink, BatchStats& stats) {
+	auto waited = chrono::steady_clock::now();
+	slot.read.wait();
+	if (sink) {
+		sink->write(slot.staging.host, slot.frame);
+	}
+	slot.busy = false;
+	++stats.frames;
+	stats.bytes += size_t(width_) * height_ * 4;
+
+	auto finished = chrono::steady_clock::now();
+	// the first frame has no interval
+	if (bench_ && lastFinished_ != chrono::steady_clock::time_point()) {
+		cl_ulong start, end;
+		slot.kernel.getProfilingInfo(CL_PROFILING_COMMAND_START, &start);
+		slot.kernel.getProfilingInfo(CL_PROFILING_COMMAND_END, &end);
+		BenchSample sample;
+		sample.frame = slot.frame;
+		sample.frameUs = chrono::duration<double, micro>(
+				finished - lastFinished_).count();
+		sample.kernelUs = (end - start) / 1000.0;
+		sample.submitUs = chrono::duration<double, micro>(
+				slot.submitted - slot.launched).count();
+		sample.presentUs = chrono::duration<double, micro>(
+				finished - waited).count();
+		sample.latencyUs = chrono::duration<double, micro>(
+				finished - slot.launched).count();
+		bench_->add(sample);
+	}
+	lastFinished_ = finished;
+}
+
+BatchStats BatchRenderer::run(uint64_t first, uint64_t count,
+		FrameSink* sink) {
+	BatchStats stats;
+	auto start = chrono::steady_clock::now();
+
+	cl::size_t<3> origin;
+	origin[0] = origin[1] = origin[2] = 0;
+	cl::size_t<3> region;
+	region[0] = width_;
+	region[1] = height_;
+	region[2] = 1;
+
+	for (uint64_t n = first; n < first + count; ++n) {
+		Slot& s = slots_[n % slots_.size()];
+		if (s.busy) {
+			finish(s, sink, stats);
+		}
+
+		s.launched = chrono::steady_clock::now();
+		kernel_.setArg(0, s.image);
+		kernel_.setArg(1, frame_x(n, steps_));
+		if (src_()) {
+			kernel_.setArg(2, src_);
+		} else {
+			kernel_.setArg(2, sizeof(cl_mem), NULL);
+		}
+		kernel_.setArg(3, srcWidth_);
+		kernel_.setArg(4, srcHeight_);
+		vector<cl::Event> wait;
+		if (steps_ > 1) {
+			kernel_.setArg(5, state_);
+			kernel_.setArg(6, frame_dx(steps_));
+			kernel_.setArg(7, steps_);
+			wait.push_back(lastKernel_);
+		}
+
+		cl::Event kernelDone;
+		s.queue.enqueueNDRangeKernel(kernel_, cl::NullRange,
+				cl::NDRange(width_, height_), cl::NullRange,
+				wait.empty() ? NULL : &wait, &kernelDone);
+		lastKernel_ = kernelDone;
+		s.kernel = kernelDone;
+		s.queue.enqueueReadImage(s.image, CL_FALSE, origin, region, 0, 0,
+				s.staging.host, NULL, &s.read);
+		s.queue.flush();
+		s.submitted = chrono::steady_clock::now();
+		s.frame = n;
+		s.busy = true;
+	}
+
+	// the remaining slots, oldest first
+	for (size_t i = 0; i < slots_.size(); ++i) {
+		Slot& s = slots_[(first + count + i) % slots_.size()];
+		if (s.busy) {
+			finish(s, sink, stats);
+		}
+	}
+
+	stats.seconds = chrono::duration<double>(
+			chrono::steady_clock::now() - start).count();
+	return stats;
+}
+
+static cl::Device batch_device(const cl::Platform& platform) {
+	vector<cl::Device> devices;
+	try {
+		platform.getDevices(CL_DEVICE_TYPE_GPU, &devices);
+	} catch (cl::Error error) {
+		// CL_DEVICE_NOT_FOUND, fall back to whatever there is
+	}
+	if (devices.empty()) {
+		platform.getDevices(CL_DEVICE_TYPE_ALL, &devices);
+	}
+	return devices.at(0);
+}
+
+static void print_stats(const BatchStats& stats) {
+	cout << "Batch: " << stats.frames << " frames in "
+		<< stats.seconds << " s";
+	// no rates for an empty range, or one under the clock's resolution
+	if (stats.seconds > 0) {
+		cout << ", " << stats.frames / stats.seconds << " frames/s, "
+			<< stats.bytes / stats.seconds / 1e9 << " GB/s";
+	}
+	cout << endl;
+}
+
+int RunBatch(const Options& opts, const cl::Platform& platform,
+		const string& kernelSource, const ProgramCache& cache,
+		int width, int height) {
+	try {
+		vector<cl::Device> devices(1, batch_device(platform));
+		cl::Context context(devices);
+		cl::CommandQueue queue(context, devices[0]);
+		// destroyed before the context and queue
+		unique_ptr<ClArena> arena(new ClArena(context, queue));
+
+		cl::Program program = BuildClProgram(context, devices,
+				kernelSource, cache);
+		cl::Kernel kernel(program, kernel_name(opts));
+
+		if (opts.validate) {
+			// both paths of the kernels: their own colour, then an
+			// input frame scaled to the frame size
+			int srcWidth = width * 2 / 3 + 1;
+			int srcHeight = height / 2 + 1;
+			vector<unsigned char> pattern = test_pattern(srcWidth,
+					srcHeight);
+			bool passed = true;
+			for (int pass = 0; pass < 2; ++pass) {
+				const unsigned char* src = pass ? pattern.data() : nullptr;
+				ReferenceCheck check(width, height, opts.stepsPerFrame,
+						src, srcWidth, srcHeight);
+				BatchStats stats;
+				{
+					BatchRenderer renderer(*arena, devices[0], kernel, width,
+							height, opts.batchDepth, opts.stepsPerFrame);
+					if (src) {
+						renderer.setInput(src, srcWidth, srcHeight);
+					}
+					stats = renderer.run(opts.batchFirst, opts.batchFrames,
+							&check);
+				}
+				print_stats(stats);
+				check.report();
+				passed = passed && check.passed();
+			}
+			return passed ? 0 : 1;
+		}
+
+		unique_ptr<FrameSink> sink;
+		if (!opts.capturePath.empty()) {
+			sink.reset(new FileSink(opts.capturePath, width, height));
+		} else if (!opts.outputShm.empty()) {
+			sink.reset(new SharedMemorySink(opts.outputShm, width, height));
+		}
+
+		unique_ptr<BenchRecorder> bench;
+		if (!opts.benchPath.empty()) {
+			bench.reset(new BenchRecorder(opts.benchPath));
+		}
+
+		BatchStats stats;
+		{
+			BatchRenderer renderer(*arena, devices[0], kernel, width,
+					height, opts.batchDepth, opts.stepsPerFrame);
+			renderer.setBench(bench.get());
+			stats = renderer.run(opts.batchFirst, opts.batchFrames,
+					sink.get());
+		}
+
+		print_stats(stats);
+		if (bench && bench->write()) {
+			cout << "Bench: " << bench->count() << " frames written to "
+				<< opts.benchPath << endl;
+		}
+	} catch (cl::Error error) {
+		cerr << error.what() << "(" << error.err() << ")" << endl;
+		return 1;
+	} catch (exception& error) {
+		cerr << error.what() << endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,89 @@
+#ifndef BATCH_RENDER_HPP
+#define BATCH_RENDER_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#define __CL_ENABLE_EXCEPTIONS
+#include "CL/cl.hpp"
+
+#include "bench.hpp"
+#include "cl_arena.hpp"
+#include "frame_sink.hpp"
+#include "options.hpp"
+#include "program_cache.hpp"
+
+struct BatchStats {
+	uint64_t frames = 0;
+	// read back from the device and handed to the sink
+	uint64_t bytes = 0;
+	double seconds = 0;
+};
+
+/*
+ * Renders a frame range as fast as the device allows, without a window.
+ *
+ * Each of `inFlight` slots has its own queue, RGBA8 image and pinned
+ * staging buffer; frame n runs in slot n % inFlight, so while the host
+ * hands one slot's frame to the sink the others are still rendering and
+ * reading back. Frames reach the sink in order. With more than one step
+ * per frame (glk_steps) each launch waits for the previous one, the
+ * state carries over from frame to frame.
+ */
+class BatchRenderer {
+public:
+	BatchRenderer(ClArena& arena, const cl::Device& device,
+			const cl::Kernel& kernel, int width, int height, int inFlight,
+			int steps);
+	~BatchRenderer();
+
+	BatchRenderer(const BatchRenderer&) = delete;
+	BatchRenderer& operator=(const BatchRenderer&) = delete;
+
+	// a fixed input frame for every launch, RGBA8 top row first
+	void setInput(const unsigned char* rgba, int width, int height);
+	// a sample per frame from run() on, for --bench
+	void setBench(BenchRecorder* bench) { bench_ = bench; }
+
+	BatchStats run(uint64_t first, uint64_t count, FrameSink* sink);
+
+private:
+	struct Slot {
+		cl::CommandQueue queue;
+		cl::Image2D image;
+		ClArena::Staging staging;
+		cl::Event kernel;
+		cl::Event read;
+		uint64_t frame = 0;
+		bool busy = false;
+		std::chrono::steady_clock::time_point launched, submitted;
+	};
+
+	void finish(Slot& slot, FrameSink* sink, BatchStats& stats);
+
+	ClArena& arena_;
+	cl::Kernel kernel_;
+	int width_, height_;
+	int steps_;
+	cl::Buffer state_;
+	cl::Buffer src_;
+	int srcWidth_ = 0, srcHeight_ = 0;
+	std::vector<Slot> slots_;
+	cl::Event lastKernel_;
+	BenchRecorder* bench_ = nullptr;
+	std::chrono::steady_clock::time_point lastFinished_;
+};
+
+/*
+ * --batch: the whole offline run on the first GPU of platform (any
+ * device if it has none), with its own context, recording --bench.
+ * Returns the exit code, with --validate 1 when the frames don't match
+ * the CPU renderer.
+ */
+int RunBatch(const Options& opts, const cl::Platform& platform,
+		const std::string& kernelSource, const ProgramCache& cache,
+		int width, int height);
+
+#endif
@@ -0,0 +1,76 @@
+#include "bench.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+
+const char* const BENCH_STAGES[] = {
+	"frame_us", "kernel_us", "submit_us", "present_us", "latency_us"
+};
+
+double BenchStage(const BenchSample& sample, int stage) {
+	switch (stage) {
+	case 0: return sample.frameUs;
+	case 1: return sample.kernelUs;
+	case 2: return sample.submitUs;
+	case 3: return sample.presentUs;
+	default: return sample.latencyUs;
+	}
+}
+
+static string header() {
+	string h = "frame";
+	for (int i = 0; i < BENCH_STAGE_COUNT; ++i) {
+		h += ",";
+		h += BENCH_STAGES[i];
+	}
+	return h;
+}
+
+bool BenchRecorder::write() const {
+	ofstream out(path_);
+	out << header() << "\n";
+	for (const BenchSample& s : samples_) {
+		out << s.frame;
+		for (int i = 0; i < BENCH_STAGE_COUNT; ++i) {
+			out << "," << BenchStage(s, i);
+		}
+		out << "\n";
+	}
+	out.flush();
+	if (!out) {
+		cerr << "Can't write " << path_ << endl;
+		return false;
+	}
+	return true;
+}
+
+bool ReadBench(const string& path, vector<BenchSample>& samples) {
+	ifstream in(path);
+	string line;
+	if (!getline(in, line) || line != header()) {
+		cerr << path << ": not a --bench file" << endl;
+		return false;
+	}
+	int number = 1;
+	while (getline(in, line)) {
+		++number;
+		if (line.empty()) {
+			continue;
+		}
+		istringstream fields(line);
+		BenchSample s;
+		char comma;
+		fields >> s.frame >> comma >> s.frameUs >> comma >> s.kernelUs
+			>> comma >> s.submitUs >> comma >> s.presentUs >> comma
+			>> s.latencyUs;
+		if (!fields) {
+			cerr << path << ":" << number << ": bad sample" << endl;
+			return false;
+		}
+		samples.push_back(s);
+	}
+	return true;
+}
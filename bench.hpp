@@ -0,0 +1,56 @@
+#ifndef BENCH_HPP
+#define BENCH_HPP
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*
+ * Timings of one presented frame for --bench, in microseconds:
+ * frame is the interval since the previous present, kernel the device
+ * time of the frame's launches (the CPU renderer's time without
+ * OpenCL), submit from the latch until the frame was handed over,
+ * present from taking it until the swap returned, latency from the
+ * latch to the present. A --batch frame has no latch or swap: submit is
+ * its launch, present the wait for its read-back plus the sink, latency
+ * from the launch until the sink has it.
+ */
+struct BenchSample {
+	uint64_t frame = 0;
+	double frameUs = 0;
+	double kernelUs = 0;
+	double submitUs = 0;
+	double presentUs = 0;
+	double latencyUs = 0;
+};
+
+// the CSV columns after frame, in BenchSample order
+extern const char* const BENCH_STAGES[];
+const int BENCH_STAGE_COUNT = 5;
+
+double BenchStage(const BenchSample& sample, int stage);
+
+/*
+ * Collects the samples of a run in memory, the file is only written at
+ * the end so the frame loop does no I/O. Render thread only.
+ */
+class BenchRecorder {
+public:
+	explicit BenchRecorder(std::string path) : path_(std::move(path)) {}
+
+	void add(const BenchSample& sample) { samples_.push_back(sample); }
+	size_t count() const { return samples_.size(); }
+
+	// false with a message on cerr when the file can't be written
+	bool write() const;
+
+private:
+	std::string path_;
+	std::vector<BenchSample> samples_;
+};
+
+// false with a message on cerr when path isn't a --bench file
+bool ReadBench(const std::string& path, std::vector<BenchSample>& samples);
+
+#endif
@@ -0,0 +1,198 @@
+/*
+ * oglcl_bench_compare BASE NEW: compares two --bench runs stage by stage
+ * and exits with 1 when NEW is significantly slower than BASE.
+ *
+ * A stage regresses when NEW's samples are larger by a one-sided
+ * Mann-Whitney U test at --alpha and its median grew by more than
+ * --threshold percent, or when the lower bound of a bootstrap confidence
+ * interval (1 - alpha) of its p99 ratio is above the threshold. The first
+ * --warmup frames of each run are left out.
+ */
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "bench.hpp"
+
+using namespace std;
+
+const int BOOTSTRAP_RESAMPLES = 2000;
+
+static void usage(const char* argv0) {
+	cerr << "Usage: " << argv0 << " [options] BASE.csv NEW.csv\n"
+		<< "  --threshold PCT        allowed slowdown, default 5\n"
+		<< "  --alpha A              significance level, default 0.01\n"
+		<< "  --warmup N             frames skipped per run, default 30\n";
+}
+
+// nearest rank, sorted input
+static double percentile(const vector<double>& sorted, double p) {
+	if (sorted.empty()) {
+		return 0;
+	}
+	size_t rank = size_t(ceil(p / 100 * sorted.size()));
+	return sorted[min(sorted.size(), max<size_t>(rank, 1)) - 1];
+}
+
+/*
+ * One-sided p-value for "b tends to be larger than a": the normal
+ * approximation of U with tie correction and continuity correction.
+ */
+static double mann_whitney_greater(const vector<double>& a,
+		const vector<double>& b) {
+	double n1 = double(a.size());
+	double n2 = double(b.size());
+	vector<pair<double, int> > all;
+	for (double v : a) {
+		all.push_back(make_pair(v, 0));
+	}
+	for (double v : b) {
+		all.push_back(make_pair(v, 1));
+	}
+	sort(all.begin(), all.end());
+
+	double rankSumB = 0;
+	double ties = 0;
+	for (size_t i = 0; i < all.size();) {
+		size_t j = i;
+		while (j < all.size() && all[j].first == all[i].first) {
+			++j;
+		}
+		// ranks i + 1 to j share their average
+		double rank = (i + 1 + j) / 2.0;
+		for (size_t k = i; k < j; ++k) {
+			if (all[k].second) {
+				rankSumB += rank;
+			}
+		}
+		double t = double(j - i);
+		ties += t * t * t - t;
+		i = j;
+	}
+
+	double n = n1 + n2;
+	double u = rankSumB - n2 * (n2 + 1) / 2;
+	double mean = n1 * n2 / 2;
+	double var = n1 * n2 / 12 * ((n + 1) - ties / (n * (n - 1)));
+	if (var <= 0) {
+		return 1;
+	}
+	double z = (u - mean - 0.5) / sqrt(var);
+	return 0.5 * erfc(z / sqrt(2.0));
+}
+
+// lower bound of the bootstrap interval of p99(b) / p99(a)
+static double p99_ratio_lower_bound(const vector<double>& a,
+		const vector<double>& b, double alpha) {
+	mt19937 rng(1);
+	vector<double> ratios;
+	vector<double> ra(a.size()), rb(b.size());
+	for (int r = 0; r < BOOTSTRAP_RESAMPLES; ++r) {
+		for (double& v : ra) {
+			v = a[rng() % a.size()];
+		}
+		for (double& v : rb) {
+			v = b[rng() % b.size()];
+		}
+		sort(ra.begin(), ra.end());
+		sort(rb.begin(), rb.end());
+		double base = percentile(ra, 99);
+		ratios.push_back(base > 0 ? percentile(rb, 99) / base : 1);
+	}
+	sort(ratios.begin(), ratios.end());
+	return percentile(ratios, 100 * alpha);
+}
+
+static double change(double base, double now) {
+	return base > 0 ? 100 * (now - base) / base : 0;
+}
+
+int main(int argc, char* argv[]) {
+	double threshold = 5;
+	double alpha = 0.01;
+	size_t warmup = 30;
+	vector<const char*> files;
+	for (int i = 1; i < argc; ++i) {
+		const char* arg = argv[i];
+		if (!strcmp(arg, "--threshold") && i + 1 < argc) {
+			threshold = atof(argv[++i]);
+		} else if (!strcmp(arg, "--alpha") && i + 1 < argc) {
+			alpha = atof(argv[++i]);
+		} else if (!strcmp(arg, "--warmup") && i + 1 < argc) {
+			warmup = strtoul(argv[++i], NULL, 10);
+		} else if (arg[0] == '-' && arg[1] == '-') {
+			cerr << "Unknown option: " << arg << endl;
+			usage(argv[0]);
+			return 2;
+		} else {
+			files.push_back(arg);
+		}
+	}
+	if (files.size() != 2 || threshold < 0 || alpha <= 0 || alpha >= 1) {
+		usage(argv[0]);
+		return 2;
+	}
+
+	vector<BenchSample> runs[2];
+	for (int r = 0; r < 2; ++r) {
+		if (!ReadBench(files[r], runs[r])) {
+			return 2;
+		}
+		if (runs[r].size() <= warmup + 1) {
+			cerr << files[r] << ": " << runs[r].size()
+				<< " frames, not enough after the warmup" << endl;
+			return 2;
+		}
+		runs[r].erase(runs[r].begin(), runs[r].begin() + warmup);
+	}
+
+	printf("%-11s %10s %10s %7s %10s %10s %7s %9s\n", "stage",
+			"base p50", "new p50", "change", "base p99", "new p99",
+			"change", "p");
+	int regressions = 0;
+	for (int stage = 0; stage < BENCH_STAGE_COUNT; ++stage) {
+		vector<double> values[2];
+		for (int r = 0; r < 2; ++r) {
+			for (const BenchSample& s : runs[r]) {
+				values[r].push_back(BenchStage(s, stage));
+			}
+			sort(values[r].begin(), values[r].end());
+		}
+		double p50[2], p99[2];
+		for (int r = 0; r < 2; ++r) {
+			p50[r] = percentile(values[r], 50);
+			p99[r] = percentile(values[r], 99);
+		}
+		if (p99[0] == 0 && p99[1] == 0) {
+			// not measured in this configuration
+			continue;
+		}
+
+		double p = mann_whitney_greater(values[0], values[1]);
+		bool median = p < alpha && change(p50[0], p50[1]) > threshold;
+		bool tail = p99_ratio_lower_bound(values[0], values[1], alpha)
+			> 1 + threshold / 100;
+		printf("%-11s %10.1f %10.1f %+6.1f%% %10.1f %10.1f %+6.1f%% %9.2g%s\n",
+				BENCH_STAGES[stage], p50[0], p50[1],
+				change(p50[0], p50[1]), p99[0], p99[1],
+				change(p99[0], p99[1]), p,
+				median && tail ? "  REGRESSION (p50, p99)"
+				: median ? "  REGRESSION (p50)"
+				: tail ? "  REGRESSION (p99)" : "");
+		if (median || tail) {
+			++regressions;
+		}
+	}
+
+	if (regressions) {
+		printf("%d stages regressed beyond %g%%\n", regressions, threshold);
+		return 1;
+	}
+	printf("No regression beyond %g%%\n", threshold);
+	return 0;
+}
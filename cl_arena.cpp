@@ -0,0 +1,160 @@
+#include "cl_arena.hpp"
+
+#include <algorithm>
+
+using namespace std;
+
+enum { KIND_BUFFER, KIND_IMAGE, KIND_STAGING };
+
+static size_t size_class(size_t size) {
+	size_t c = 4096;
+	while (c < size) {
+		c <<= 1;
+	}
+	return c;
+}
+
+static bool completed(const cl::Event& done) {
+	if (!done()) {
+		return true;
+	}
+	cl_int status;
+	done.getInfo(CL_EVENT_COMMAND_EXECUTION_STATUS, &status);
+	// negative is an error, the command won't touch the object anymore
+	return status <= CL_COMPLETE;
+}
+
+ClArena::ClArena(const cl::Context& context, const cl::CommandQueue& queue)
+	: context_(context), queue_(queue) {}
+
+ClArena::~ClArena() {
+	lock_guard<mutex> lk(m_);
+	for (auto& r : staging_.retired) {
+		r.done.wait();
+		staging_.free[r.key].push_back(r.obj);
+	}
+	for (auto& f : staging_.free) {
+		for (Staging& s : f.second) {
+			queue_.enqueueUnmapMemObject(s.buffer, s.host);
+		}
+	}
+	queue_.finish();
+}
+
+template <typename T, typename Create>
+T ClArena::take(Pool<T>& pool, const Key& key, size_t bytes, Create create) {
+	collectPool(pool);
+
+	T obj;
+	auto it = pool.free.find(key);
+	if (it != pool.free.end() && !it->second.empty()) {
+		obj = it->second.back();
+		it->second.pop_back();
+		++stats_.reuses;
+	} else {
+		obj = create();
+		++stats_.creates;
+		stats_.bytes += bytes;
+		stats_.highWater = max(stats_.highWater, stats_.bytes);
+	}
+	stats_.inUse += bytes;
+	stats_.inUseHighWater = max(stats_.inUseHighWater, stats_.inUse);
+	return obj;
+}
+
+template <typename T>
+void ClArena::give(Pool<T>& pool, const T& obj, cl_mem mem,
+		const cl::Event& done) {
+	auto it = pool.out.find(mem);
+	if (it == pool.out.end()) {
+		return;
+	}
+	typename Pool<T>::Retired r;
+	r.key = it->second.first;
+	r.obj = obj;
+	r.done = done;
+	stats_.inUse -= it->second.second;
+	pool.out.erase(it);
+	pool.retired.push_back(r);
+}
+
+template <typename T>
+void ClArena::collectPool(Pool<T>& pool) {
+	auto keep = pool.retired.begin();
+	for (auto it = pool.retired.begin(); it != pool.retired.end(); ++it) {
+		if (completed(it->done)) {
+			pool.free[it->key].push_back(it->obj);
+		} else {
+			*keep++ = *it;
+		}
+	}
+	pool.retired.erase(keep, pool.retired.end());
+}
+
+cl::Buffer ClArena::buffer(size_t size, cl_mem_flags flags) {
+	size_t bytes = size_class(size);
+	Key key(KIND_BUFFER, flags, bytes, 0, 0, 0);
+	lock_guard<mutex> lk(m_);
+	cl::Buffer b = take(buffers_, key, bytes, [&]() {
+		return cl::Buffer(context_, flags, bytes);
+	});
+	buffers_.out[b()] = make_pair(key, bytes);
+	return b;
+}
+
+cl::Image2D ClArena::image(const cl::ImageFormat& format, size_t width,
+		size_t height, cl_mem_flags flags) {
+	// close enough for the statistics, the element size isn't queried
+	size_t bytes = width * height * 4;
+	Key key(KIND_IMAGE, flags, width, height, format.image_channel_order,
+			format.image_channel_data_type);
+	lock_guard<mutex> lk(m_);
+	cl::Image2D img = take(images_, key, bytes, [&]() {
+		return cl::Image2D(context_, flags, format, width, height);
+	});
+	images_.out[img()] = make_pair(key, bytes);
+	return img;
+}
+
+ClArena::Staging ClArena::staging(size_t size) {
+	size_t bytes = size_class(size);
+	Key key(KIND_STAGING, CL_MEM_ALLOC_HOST_PTR, bytes, 0, 0, 0);
+	lock_guard<mutex> lk(m_);
+	Staging s = take(staging_, key, bytes, [&]() {
+		Staging n;
+		n.buffer = cl::Buffer(context_, CL_MEM_ALLOC_HOST_PTR, bytes);
+		n.host = static_cast<unsigned char*>(queue_.enqueueMapBuffer(
+					n.buffer, CL_TRUE, CL_MAP_READ | CL_MAP_WRITE, 0, bytes));
+		n.size = bytes;
+		return n;
+	});
+	staging_.out[s.buffer()] = make_pair(key, bytes);
+	return s;
+}
+
+void ClArena::recycle(const cl::Buffer& b, const cl::Event& done) {
+	lock_guard<mutex> lk(m_);
+	give(buffers_, b, b(), done);
+}
+
+void ClArena::recycle(const cl::Image2D& img, const cl::Event& done) {
+	lock_guard<mutex> lk(m_);
+	give(images_, img, img(), done);
+}
+
+void ClArena::recycle(const Staging& s, const cl::Event& done) {
+	lock_guard<mutex> lk(m_);
+	give(staging_, s, s.buffer(), done);
+}
+
+void ClArena::collect() {
+	lock_guard<mutex> lk(m_);
+	collectPool(buffers_);
+	collectPool(images_);
+	collectPool(staging_);
+}
+
+ArenaStats ClArena::stats() const {
+	lock_guard<mutex> lk(m_);
+	return stats_;
+}
@@ -0,0 +1,102 @@
+#ifndef CL_ARENA_HPP
+#define CL_ARENA_HPP
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+#define __CL_ENABLE_EXCEPTIONS
+#include "CL/cl.hpp"
+
+struct ArenaStats {
+	// clCreate* calls, and requests served from the pool instead
+	uint64_t creates = 0;
+	uint64_t reuses = 0;
+	// bytes allocated, pooled or handed out, and their peak
+	size_t bytes = 0;
+	size_t highWater = 0;
+	// bytes handed out and not recycled yet, and their peak
+	size_t inUse = 0;
+	size_t inUseHighWater = 0;
+};
+
+/*
+ * Recycles buffers, images and pinned staging buffers of one context, so
+ * per-frame work stops calling clCreate* once the pool is warm.
+ *
+ * Buffers come in power-of-two size classes, images by exact format and
+ * size. recycle() takes the event of the last command using the object;
+ * it is only handed out again once that completed. Everything handed out
+ * must be recycled before the arena is destroyed. Thread-safe.
+ */
+class ClArena {
+public:
+	struct Staging {
+		cl::Buffer buffer;
+		// CL_MEM_ALLOC_HOST_PTR, mapped for the lifetime of the arena
+		unsigned char* host = nullptr;
+		size_t size = 0;
+	};
+
+	ClArena(const cl::Context& context, const cl::CommandQueue& queue);
+	~ClArena();
+
+	ClArena(const ClArena&) = delete;
+	ClArena& operator=(const ClArena&) = delete;
+
+	// size is rounded up to the size class
+	cl::Buffer buffer(size_t size, cl_mem_flags flags);
+	cl::Image2D image(const cl::ImageFormat& format, size_t width,
+			size_t height, cl_mem_flags flags);
+	Staging staging(size_t size);
+
+	void recycle(const cl::Buffer& buffer, const cl::Event& done = cl::Event());
+	void recycle(const cl::Image2D& image, const cl::Event& done = cl::Event());
+	void recycle(const Staging& staging, const cl::Event& done = cl::Event());
+
+	// returns retired objects whose event completed to the pool; also
+	// done on every request, call it once per frame to keep lists short
+	void collect();
+
+	ArenaStats stats() const;
+
+	const cl::Context& context() const { return context_; }
+
+private:
+	// (kind, flags, size or width, height, channel order, channel type)
+	typedef std::tuple<int, cl_mem_flags, size_t, size_t, cl_uint, cl_uint>
+		Key;
+
+	template <typename T>
+	struct Pool {
+		std::map<Key, std::vector<T> > free;
+		struct Retired {
+			Key key;
+			T obj;
+			cl::Event done;
+		};
+		std::vector<Retired> retired;
+		// handed out objects, to find their key and size on recycle
+		std::map<cl_mem, std::pair<Key, size_t> > out;
+	};
+
+	template <typename T, typename Create>
+	T take(Pool<T>& pool, const Key& key, size_t bytes, Create create);
+	template <typename T>
+	void give(Pool<T>& pool, const T& obj, cl_mem mem, const cl::Event& done);
+	template <typename T>
+	void collectPool(Pool<T>& pool);
+
+	cl::Context context_;
+	cl::CommandQueue queue_;
+
+	mutable std::mutex m_;
+	Pool<cl::Buffer> buffers_;
+	Pool<cl::Image2D> images_;
+	Pool<Staging> staging_;
+	ArenaStats stats_;
+};
+
+#endif
@@ -0,0 +1,100 @@
+#include "cl_setup.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+
+using namespace std;
+
+void PrintDevices(const vector<cl::Device>& devices) {
+	for (cl::Device d : devices) {
+		string t;
+		d.getInfo(CL_DEVICE_NAME, &t);
+		cout << "Device Name: "
+			<< t << endl;
+		cl_device_type dt;
+		d.getInfo(CL_DEVICE_TYPE, &dt);
+		cout << "Device Type: "
+			<< dt << endl;
+		d.getInfo(CL_DRIVER_VERSION, &t);
+		cout << "Device Driver: "
+			<< t << endl;
+		cl_uint dcu;
+		d.getInfo(CL_DEVICE_MAX_COMPUTE_UNITS, &dcu);
+		cout << "Device MCU: " << dcu << endl;
+		d.getInfo(CL_DEVICE_EXTENSIONS, &t);
+		cout << "Device Extensions: "
+			<< t << endl;
+	}
+}
+
+void PrintPlatforms(const vector<cl::Platform>& platforms) {
+	try {
+		cout << "N Platforms: " << platforms.size() << endl;
+		std::string t;
+
+		cout << string(32, '-') << endl;
+		for (cl::Platform p : platforms) {
+			p.getInfo(CL_PLATFORM_NAME, &t);
+			cout << "Platform Name: " << t << endl;
+
+			p.getInfo(CL_PLATFORM_VERSION, &t);
+			cout << "Platform Version: " << t << endl;
+
+			vector<cl::Device> devices;
+
+			p.getDevices(CL_DEVICE_TYPE_ALL, &devices);
+			cout << "Platform N Devices: " << devices.size()
+				<< endl;
+
+			PrintDevices(devices);
+			cout << string(32,'-') << endl;
+		}
+	} catch (cl::Error error) {
+		cout << error.what() << "(" <<
+			error.err() << ")" << endl;
+	}
+}
+
+cl::Device GetGLInteropDevice(const cl::Platform& platform,
+		cl_context_properties* cl_properties) {
+	clGetGLContextInfoKHR_fn clGetGLContextInfoKHR =
+		(clGetGLContextInfoKHR_fn)
+		clGetExtensionFunctionAddressForPlatform(
+				platform(),"clGetGLContextInfoKHR");
+	if (!clGetGLContextInfoKHR) {
+		std::cerr
+			<< "clGetGLContextInfoKHR"
+			<< endl;
+		throw runtime_error{"clGetGLContextInfoKHR"};
+	}
+
+
+	size_t devicesSize;
+	auto status = clGetGLContextInfoKHR(cl_properties,
+			CL_CURRENT_DEVICE_FOR_GL_CONTEXT_KHR, 0, NULL, &devicesSize);
+	if (status != CL_SUCCESS) {
+		cerr << status << endl;
+		throw runtime_error{"clGetGLContextInfoKHR"};
+	}
+
+	cl_device_id c_cl_gl_device;
+	status = clGetGLContextInfoKHR(cl_properties,
+			CL_CURRENT_DEVICE_FOR_GL_CONTEXT_KHR, sizeof(cl_device_id),
+			&c_cl_gl_device, NULL);
+	if(status != CL_SUCCESS) {
+		cerr << status << endl;
+		throw runtime_error{"clGetGLContextInfoKHR"};
+	}
+	return cl::Device{c_cl_gl_device};
+}
+
+string ReadSource(const string& path) {
+	ifstream sourceFile(path);
+	if (!sourceFile) {
+		throw runtime_error{"cannot open " + path};
+	}
+	return string(istreambuf_iterator<char>(sourceFile),
+			(istreambuf_iterator<char>()));
+}
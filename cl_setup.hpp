@@ -0,0 +1,23 @@
+#ifndef CL_SETUP_HPP
+#define CL_SETUP_HPP
+
+#include <string>
+#include <vector>
+
+#define __CL_ENABLE_EXCEPTIONS
+#include "CL/cl.hpp"
+
+// verbose listing of every platform and device, diagnostics only
+void PrintPlatforms(const std::vector<cl::Platform>& platforms);
+void PrintDevices(const std::vector<cl::Device>& devices);
+
+/*
+ * The device of platform driving the GL context described by
+ * cl_properties. Throws runtime_error when there is none.
+ */
+cl::Device GetGLInteropDevice(const cl::Platform& platform,
+		cl_context_properties* cl_properties);
+
+std::string ReadSource(const std::string& path);
+
+#endif
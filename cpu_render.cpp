@@ -0,0 +1,169 @@
+#include "cpu_render.hpp"
+
+#include <cmath>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+// rows per tile: a few tiles per thread, long rows for the SIMD loops
+static const int TILE_ROWS = 16;
+
+// unorm8() of the kernel: convert_uchar_sat_rte(v * 255), with the
+// clamp first, which rounds the same
+static unsigned char to_unorm8(float v) {
+	v = v < 0.f ? 0.f : v > 1.f ? 1.f : v;
+	return (unsigned char)nearbyintf(v * 255.f);
+}
+
+static uint32_t pack(float r, float g, float b, float a) {
+	unsigned char p[4] = {to_unorm8(r), to_unorm8(g), to_unorm8(b),
+		to_unorm8(a)};
+	uint32_t v;
+	memcpy(&v, p, 4);
+	return v;
+}
+
+static void fill_row(uint32_t* dst, int n, uint32_t pixel) {
+	int i = 0;
+#if defined(__AVX2__)
+	__m256i v = _mm256_set1_epi32(int(pixel));
+	for (; i + 8 <= n; i += 8) {
+		_mm256_storeu_si256((__m256i*)(dst + i), v);
+	}
+#elif defined(__SSE2__)
+	__m128i v = _mm_set1_epi32(int(pixel));
+	for (; i + 4 <= n; i += 4) {
+		_mm_storeu_si128((__m128i*)(dst + i), v);
+	}
+#endif
+	for (; i < n; ++i) {
+		dst[i] = pixel;
+	}
+}
+
+// dst[i] = src[cols[i]]; the pixel survives the float round trip of the
+// kernel unchanged, b / 255 * 255 rounds back to b
+static void gather_row(uint32_t* dst, const uint32_t* src, const int* cols,
+		int n) {
+	int i = 0;
+#if defined(__AVX2__)
+	for (; i + 8 <= n; i += 8) {
+		__m256i idx = _mm256_loadu_si256((const __m256i*)(cols + i));
+		_mm256_storeu_si256((__m256i*)(dst + i),
+				_mm256_i32gather_epi32((const int*)src, idx, 4));
+	}
+#endif
+	for (; i < n; ++i) {
+		dst[i] = src[cols[i]];
+	}
+}
+
+CpuRenderer::CpuRenderer(TaskScheduler& tasks, int width, int height)
+	: width_(width), height_(height), tasks_(tasks) {}
+
+const vector<int>& CpuRenderer::columns(int srcWidth) {
+	if (columnsFor_ != srcWidth) {
+		columns_.resize(width_);
+		for (int x = 0; x < width_; ++x) {
+			columns_[x] = x * srcWidth / width_;
+		}
+		columnsFor_ = srcWidth;
+	}
+	return columns_;
+}
+
+void CpuRenderer::render(unsigned char* rgba, size_t stride, float x,
+		const unsigned char* src, int srcWidth, int srcHeight) {
+	int tiles = (height_ + TILE_ROWS - 1) / TILE_ROWS;
+	++frame_;
+	if (!src) {
+		uint32_t pixel = pack(x, 0.f, 1.f, 1.f);
+		tasks_.parallelFor(frame_, tiles, [&](int t) {
+			int end = min(height_, (t + 1) * TILE_ROWS);
+			for (int y = t * TILE_ROWS; y < end; ++y) {
+				fill_row((uint32_t*)(rgba + y * stride), width_, pixel);
+			}
+		});
+		return;
+	}
+
+	const int* cols = columns(srcWidth).data();
+	tasks_.parallelFor(frame_, tiles, [&](int t) {
+		int end = min(height_, (t + 1) * TILE_ROWS);
+		for (int y = t * TILE_ROWS; y < end; ++y) {
+			// top row first in src, as in the kernel
+			int sy = srcHeight - 1 - y * srcHeight / height_;
+			gather_row((uint32_t*)(rgba + y * stride),
+					(const uint32_t*)(src + size_t(sy) * srcWidth * 4),
+					cols, width_);
+		}
+	});
+}
+
+void CpuRenderer::renderSteps(unsigned char* rgba, size_t stride, float x,
+		float dx, int steps, const unsigned char* src, int srcWidth,
+		int srcHeight) {
+	++frame_;
+	if (state_.empty()) {
+		state_.assign(size_t(width_) * height_ * 4, 0.f);
+	}
+	// without src every pixel eases towards the same colour per step
+	vector<float> targets(size_t(steps) * 4);
+	for (int k = 1; k <= steps; ++k) {
+		float xk = x + k * dx;
+		float* t = &targets[(k - 1) * 4];
+		t[0] = xk - floor(xk);
+		t[1] = 0.f;
+		t[2] = 1.f;
+		t[3] = 1.f;
+	}
+	const int* cols = src ? columns(srcWidth).data() : nullptr;
+
+	int tiles = (height_ + TILE_ROWS - 1) / TILE_ROWS;
+	tasks_.parallelFor(frame_, tiles, [&](int t) {
+		int end = min(height_, (t + 1) * TILE_ROWS);
+		for (int y = t * TILE_ROWS; y < end; ++y) {
+			float* s = &state_[size_t(y) * width_ * 4];
+			unsigned char* out = rgba + y * stride;
+			const unsigned char* srow = src ? src + size_t(srcHeight - 1
+					- y * srcHeight / height_) * srcWidth * 4 : nullptr;
+			for (int px = 0; px < width_; ++px, s += 4, out += 4) {
+				float input[4];
+				if (srow) {
+					const unsigned char* p = srow + cols[px] * 4;
+					for (int c = 0; c < 4; ++c) {
+						// as source_color(), a multiply
+						input[c] = p[c] * (1.f / 255.f);
+					}
+				}
+#if defined(__SSE2__)
+				// one pixel is one float4, one register
+				__m128 v = _mm_loadu_ps(s);
+				__m128 a = _mm_set1_ps(0.1f);
+				for (int k = 0; k < steps; ++k) {
+					__m128 target = _mm_loadu_ps(srow ? input
+							: &targets[k * 4]);
+					v = _mm_add_ps(v, _mm_mul_ps(_mm_sub_ps(target, v), a));
+				}
+				_mm_storeu_ps(s, v);
+#else
+				for (int k = 0; k < steps; ++k) {
+					const float* target = srow ? input : &targets[k * 4];
+					for (int c = 0; c < 4; ++c) {
+						s[c] = s[c] + (target[c] - s[c]) * 0.1f;
+					}
+				}
+#endif
+				for (int c = 0; c < 4; ++c) {
+					out[c] = to_unorm8(s[c]);
+				}
+			}
+		}
+	});
+}
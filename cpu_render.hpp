@@ -0,0 +1,53 @@
+#ifndef CPU_RENDER_HPP
+#define CPU_RENDER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "task_scheduler.hpp"
+
+/*
+ * The kernels of gl_kernel.cl on the CPU, for running without OpenCL
+ * and as the reference the OpenCL output is validated against.
+ *
+ * Output is RGBA8 laid out like the image: row 0 first, which is the
+ * bottom row in GL. Bands of rows are spread over a TaskScheduler and
+ * the inner loops use SSE2, or AVX2 where the build enables it. Both
+ * kernels are bit-exact with a conforming OpenCL device: the kernels
+ * only use correctly rounded operations, without contraction (this file
+ * is built with -ffp-contract=off), and round to UNORM8 themselves.
+ */
+class CpuRenderer {
+public:
+	CpuRenderer(TaskScheduler& tasks, int width, int height);
+
+	CpuRenderer(const CpuRenderer&) = delete;
+	CpuRenderer& operator=(const CpuRenderer&) = delete;
+
+	// glk; src is RGBA8 top row first, or null
+	void render(unsigned char* rgba, size_t stride, float x,
+			const unsigned char* src, int srcWidth, int srcHeight);
+	// glk_steps, its state kept here across calls
+	void renderSteps(unsigned char* rgba, size_t stride, float x, float dx,
+			int steps, const unsigned char* src, int srcWidth,
+			int srcHeight);
+
+	int width() const { return width_; }
+	int height() const { return height_; }
+
+private:
+	// column of src sampled by each output column, cached per src width
+	const std::vector<int>& columns(int srcWidth);
+
+	int width_, height_;
+	TaskScheduler& tasks_;
+	// calls so far, the tag of their tasks
+	uint64_t frame_ = 0;
+	std::vector<int> columns_;
+	int columnsFor_ = -1;
+	// glk_steps state, float4 per pixel
+	std::vector<float> state_;
+};
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef EVENT_QUEUE_HPP
+#define EVENT_QUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+
+/*
+ * Bounded single-producer single-consumer ring, lock-free: the producer
+ * only writes head_, the consumer only tail_. N must be a power of two.
+ */
+template <typename T, size_t N>
+class SpscQueue {
+	static_assert((N & (N - 1)) == 0, "N must be a power of two");
+
+public:
+	// false when full, the item is not queued
+	bool push(const T& item) {
+		size_t head = head_.load(std::memory_order_relaxed);
+		if (head - tail_.load(std::memory_order_acquire) == N) {
+			return false;
+		}
+		items_[head & (N - 1)] = item;
+		head_.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool pop(T& item) {
+		size_t tail = tail_.load(std::memory_order_relaxed);
+		if (tail == head_.load(std::memory_order_acquire)) {
+			return false;
+		}
+		item = items_[tail & (N - 1)];
+		tail_.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+private:
+	T items_[N];
+	// on separate cache lines, each is written by one side only
+	alignas(64) std::atomic<size_t> head_{0};
+	alignas(64) std::atomic<size_t> tail_{0};
+};
+
+/*
+ * Window and input events, translated by the front-end on the main
+ * thread and handled by the render thread.
+ */
+struct WindowEvent {
+	enum Type { KEY, RESIZE, CLOSE };
+	enum Key { KEY_OTHER, KEY_ESCAPE, KEY_R };
+
+	Type type = KEY;
+	Key key = KEY_OTHER;
+	// front-end key code and whether it went down, for the log
+	int code = 0;
+	bool pressed = false;
+	int width = 0;
+	int height = 0;
+};
+
+typedef SpscQueue<WindowEvent, 256> EventQueue;
+
+#endif
@@ -0,0 +1,80 @@
+#include "frame_capture.hpp"
+
+#include <iostream>
+
+using namespace std;
+
+FrameCapture::FrameCapture(TaskScheduler& tasks, ClArena& arena,
+		const cl::Image& image, const string& path, int width, int height,
+		int depth)
+	: width_(width), height_(height), depth_(depth),
+	sink_(path, width, height), tasks_(tasks), arena_(arena),
+	image_(image) {}
+
+FrameCapture::~FrameCapture() {
+	finish();
+}
+
+void FrameCapture::finish() {
+	unique_lock<mutex> lk(m_);
+	cv_.wait(lk, [this] { return filled_.empty(); });
+}
+
+void FrameCapture::capture(const cl::CommandQueue& queue, uint64_t frame) {
+	{
+		lock_guard<mutex> lk(m_);
+		if (filled_.size() >= size_t(depth_)) {
+			++dropped_;
+			return;
+		}
+	}
+
+	Pending p;
+	p.staging = arena_.staging(size_t(width_) * height_ * 4);
+	p.frame = frame;
+	cl::size_t<3> origin;
+	origin[0] = origin[1] = origin[2] = 0;
+	cl::size_t<3> region;
+	region[0] = width_;
+	region[1] = height_;
+	region[2] = 1;
+	try {
+		queue.enqueueReadImage(image_, CL_FALSE, origin, region, 0, 0,
+				p.staging.host, NULL, &p.ready);
+	} catch (cl::Error error) {
+		cerr << "Capture read: " << error.err() << endl;
+		arena_.recycle(p.staging);
+		++dropped_;
+		return;
+	}
+
+	Pending* pending;
+	{
+		lock_guard<mutex> lk(m_);
+		filled_.push_back(p);
+		pending = &filled_.back();
+	}
+	tasks_.after(p.ready, frame, [this, pending] { readDone(pending); });
+}
+
+void FrameCapture::readDone(Pending* done) {
+	unique_lock<mutex> lk(m_);
+	done->read = true;
+	if (writing_) {
+		return;
+	}
+	writing_ = true;
+	// reads may complete out of order, the file is written in order
+	while (!filled_.empty() && filled_.front().read) {
+		Pending p = filled_.front();
+		lk.unlock();
+		sink_.write(p.staging.host, p.frame);
+		++written_;
+		arena_.recycle(p.staging);
+		lk.lock();
+		// popped only now, so the depth bounds the buffers in use
+		filled_.pop_front();
+	}
+	writing_ = false;
+	cv_.notify_all();
+}
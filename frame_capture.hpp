@@ -0,0 +1,80 @@
+#ifndef FRAME_CAPTURE_HPP
+#define FRAME_CAPTURE_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define __CL_ENABLE_EXCEPTIONS
+#include "CL/cl.hpp"
+
+#include "cl_arena.hpp"
+#include "frame_sink.hpp"
+#include "task_scheduler.hpp"
+
+/*
+ * Streams frames of the shared image to disk without stalling the
+ * thread that produces them.
+ *
+ * capture() enqueues a non-blocking read of the image into a pinned
+ * staging buffer from the arena and returns. The read's completion
+ * schedules a task that writes out every frame that is read, in order,
+ * and recycles their buffers. When `depth` frames are already pending
+ * the frame is dropped and counted instead.
+ *
+ * The file format is FileSink's.
+ */
+class FrameCapture {
+public:
+	// image must be RGBA8 (CL_UNORM_INT8)
+	FrameCapture(TaskScheduler& tasks, ClArena& arena,
+			const cl::Image& image, const std::string& path, int width,
+			int height, int depth = 4);
+	~FrameCapture();
+
+	// waits until whatever is still pending is written out
+	void finish();
+
+	FrameCapture(const FrameCapture&) = delete;
+	FrameCapture& operator=(const FrameCapture&) = delete;
+
+	// the image must be acquired on queue
+	void capture(const cl::CommandQueue& queue, uint64_t frame);
+
+	uint64_t written() const { return written_; }
+	uint64_t dropped() const { return dropped_; }
+
+private:
+	struct Pending {
+		ClArena::Staging staging;
+		cl::Event ready;
+		uint64_t frame;
+		bool read = false;
+	};
+
+	// p's read completed; writes out the frames read so far
+	void readDone(Pending* p);
+
+	int width_, height_;
+	int depth_;
+	FileSink sink_;
+	TaskScheduler& tasks_;
+	ClArena& arena_;
+	cl::Image image_;
+
+	std::mutex m_;
+	std::condition_variable cv_;
+	// in capture order; a deque keeps the other elements in place
+	std::deque<Pending> filled_;
+	// a task is writing, the others leave their frame to it
+	bool writing_ = false;
+
+	std::atomic<uint64_t> written_{0};
+	std::atomic<uint64_t> dropped_{0};
+};
+
+#endif
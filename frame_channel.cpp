@@ -0,0 +1,87 @@
+#include "frame_channel.hpp"
+
+using namespace std;
+
+uint64_t FrameChannel::publish(FrameInfo frame) {
+	lock_guard<mutex> lk(m_);
+	// the one being presented counts as presented, not replaced
+	if (pending_ && frame_.sequence != taken_) {
+		++replaced_;
+	}
+	frame.sequence = ++published_;
+	if (!frame.launched) {
+		++failed_;
+	}
+	frame_ = frame;
+	pending_ = true;
+	cv_.notify_all();
+	return frame.sequence;
+}
+
+bool FrameChannel::waitPresented() {
+	unique_lock<mutex> lk(m_);
+	cv_.wait(lk, [this] { return !pending_ || closed_; });
+	return !closed_;
+}
+
+FrameChannel::clock::time_point FrameChannel::lastPresent() const {
+	lock_guard<mutex> lk(m_);
+	return lastPresent_;
+}
+
+FrameChannel::Result FrameChannel::take(FrameInfo& frame,
+		chrono::milliseconds timeout) {
+	unique_lock<mutex> lk(m_);
+	cv_.wait_for(lk, timeout, [this] { return pending_ || closed_; });
+	if (closed_) {
+		return CLOSED;
+	}
+	if (!pending_) {
+		return TIMEOUT;
+	}
+	frame = frame_;
+	taken_ = frame_.sequence;
+	return FRAME;
+}
+
+void FrameChannel::presented(const FrameInfo& frame, clock::time_point when) {
+	lock_guard<mutex> lk(m_);
+	if (frame_.sequence == frame.sequence) {
+		pending_ = false;
+	}
+	lastPresent_ = when;
+	++presented_;
+	cv_.notify_all();
+}
+
+void FrameChannel::close() {
+	// under the lock, or a waiter could check the flag and miss the wake
+	lock_guard<mutex> lk(m_);
+	closed_ = true;
+	cv_.notify_all();
+}
+
+uint64_t FrameChannel::published() const {
+	lock_guard<mutex> lk(m_);
+	return published_;
+}
+
+uint64_t FrameChannel::presentedCount() const {
+	lock_guard<mutex> lk(m_);
+	return presented_;
+}
+
+bool FrameChannel::pending() const {
+	lock_guard<mutex> lk(m_);
+	return pending_;
+}
+
+uint64_t FrameChannel::replaced() const {
+	lock_guard<mutex> lk(m_);
+	return replaced_;
+}
+
+uint64_t FrameChannel::failed() const {
+	lock_guard<mutex> lk(m_);
+	return failed_;
+}
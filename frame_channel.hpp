@@ -0,0 +1,81 @@
+#ifndef FRAME_CHANNEL_HPP
+#define FRAME_CHANNEL_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+// what the render thread needs to know about a frame in the texture
+struct FrameInfo {
+	// 1, 2, ... in publish order, set by publish()
+	uint64_t sequence = 0;
+	// size of the sub-rectangle the frame was rendered into
+	int width = 0;
+	int height = 0;
+	// false when no kernel ran, the surfaces still show the last frame
+	bool launched = true;
+	// when its parameters were latched, and the timestamp of its input
+	// frame (steady clock ns, 0 without input)
+	std::chrono::steady_clock::time_point latched;
+	uint64_t inputNs = 0;
+	// for --bench: device time of its launches, latch to handover
+	double kernelMicros = 0;
+	double submitMicros = 0;
+};
+
+/*
+ * Handoff of finished frames from the thread rendering them to the one
+ * presenting them, and the shutdown flag both poll.
+ *
+ * One frame is pending at most: publishing over a frame that was not
+ * presented yet replaces it, and that is counted. The presenting thread
+ * does not hold the lock while it draws; presented() then only clears
+ * the frame it took, not a newer one published meanwhile. So every
+ * published frame is either presented once, replaced, or still pending
+ * when the channel closes.
+ */
+class FrameChannel {
+public:
+	typedef std::chrono::steady_clock clock;
+
+	enum Result { FRAME, TIMEOUT, CLOSED };
+
+	// producer: returns the sequence number given to the frame
+	uint64_t publish(FrameInfo frame);
+	// producer: until the pending frame was presented; false once closed
+	bool waitPresented();
+	clock::time_point lastPresent() const;
+
+	// consumer: the pending frame, it stays pending until presented()
+	Result take(FrameInfo& frame, std::chrono::milliseconds timeout);
+	void presented(const FrameInfo& frame, clock::time_point when);
+
+	// from any thread, wakes everyone waiting
+	void close();
+	bool closed() const { return closed_; }
+
+	uint64_t published() const;
+	uint64_t presentedCount() const;
+	uint64_t replaced() const;
+	// published with launched false
+	uint64_t failed() const;
+	// a frame was published and neither presented nor replaced yet
+	bool pending() const;
+
+private:
+	mutable std::mutex m_;
+	std::condition_variable cv_;
+	FrameInfo frame_;
+	bool pending_ = false;
+	uint64_t taken_ = 0;
+	clock::time_point lastPresent_;
+	uint64_t published_ = 0;
+	uint64_t presented_ = 0;
+	uint64_t replaced_ = 0;
+	uint64_t failed_ = 0;
+	std::atomic<bool> closed_{false};
+};
+
+#endif
@@ -0,0 +1,134 @@
+#include "frame_sink.hpp"
+
+#include <cstring>
+#include <ctime>
+#include <new>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "input_source.hpp"
+
+using namespace std;
+
+static bool ends_with(const string& s, const string& suffix) {
+	return s.size() >= suffix.size()
+		&& s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+static unsigned char clamp_byte(float v) {
+	return v < 0.f ? 0 : v > 255.f ? 255 : (unsigned char)(v + 0.5f);
+}
+
+FileSink::FileSink(const string& path, int width, int height)
+	: width_(width), height_(height), y4m_(ends_with(path, ".y4m")) {
+	out_ = fopen(path.c_str(), "wb");
+	if (!out_) {
+		throw runtime_error{"cannot open " + path};
+	}
+	if (y4m_) {
+		fprintf(out_, "YUV4MPEG2 W%d H%d F60:1 Ip A1:1 C444\n",
+				width_, height_);
+	}
+	row_.resize(size_t(width_) * 4);
+}
+
+FileSink::~FileSink() {
+	fclose(out_);
+}
+
+void FileSink::write(const unsigned char* rgba, uint64_t frame) {
+	size_t stride = size_t(width_) * 4;
+	// the image's first row is the bottom one, as in GL
+	if (!y4m_) {
+		for (int y = height_ - 1; y >= 0; --y) {
+			fwrite(rgba + y * stride, 1, stride, out_);
+		}
+		return;
+	}
+
+	// BT.601 limited range, one plane after the other
+	fputs("FRAME\n", out_);
+	for (int plane = 0; plane < 3; ++plane) {
+		for (int y = height_ - 1; y >= 0; --y) {
+			const unsigned char* p = rgba + y * stride;
+			for (int x = 0; x < width_; ++x, p += 4) {
+				float r = p[0], g = p[1], b = p[2];
+				float v;
+				if (plane == 0) {
+					v = 16.f + 0.257f * r + 0.504f * g + 0.098f * b;
+				} else if (plane == 1) {
+					v = 128.f - 0.148f * r - 0.291f * g + 0.439f * b;
+				} else {
+					v = 128.f + 0.439f * r - 0.368f * g - 0.071f * b;
+				}
+				row_[x] = clamp_byte(v);
+			}
+			fwrite(row_.data(), 1, width_, out_);
+		}
+	}
+}
+
+SharedMemorySink::SharedMemorySink(const string& name, int width,
+		int height, int slots)
+	: width_(width), height_(height), slots_(slots) {
+	size_t frameSize = size_t(width_) * height_ * 4;
+	size_ = ShmFramesOffset(slots_) + slots_ * frameSize;
+
+	int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+	if (fd < 0) {
+		throw runtime_error{"cannot create shared memory " + name};
+	}
+	if (ftruncate(fd, size_) != 0) {
+		close(fd);
+		throw runtime_error{"cannot size shared memory " + name};
+	}
+	map_ = mmap(NULL, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map_ == MAP_FAILED) {
+		throw runtime_error{"cannot map " + name};
+	}
+
+	unsigned char* base = static_cast<unsigned char*>(map_);
+	ShmRingHeader* header = new (base) ShmRingHeader;
+	header->magic = ShmRingHeader::MAGIC;
+	header->width = width_;
+	header->height = height_;
+	header->slots = slots_;
+	for (uint32_t i = 0; i < slots_; ++i) {
+		ShmSlotHeader* s = new (base + sizeof(ShmRingHeader)
+				+ i * sizeof(ShmSlotHeader)) ShmSlotHeader;
+		s->sequence.store(0, memory_order_relaxed);
+		s->timestampNs = 0;
+	}
+	header->written.store(0, memory_order_release);
+}
+
+SharedMemorySink::~SharedMemorySink() {
+	munmap(map_, size_);
+}
+
+void SharedMemorySink::write(const unsigned char* rgba, uint64_t frame) {
+	size_t stride = size_t(width_) * 4;
+	size_t frameSize = stride * height_;
+	unsigned char* base = static_cast<unsigned char*>(map_);
+	ShmRingHeader* header = reinterpret_cast<ShmRingHeader*>(base);
+	ShmSlotHeader* slot = reinterpret_cast<ShmSlotHeader*>(base
+			+ sizeof(ShmRingHeader)) + written_ % slots_;
+	unsigned char* dst = base + ShmFramesOffset(slots_)
+		+ (written_ % slots_) * frameSize;
+
+	// invalidate the slot first, a reader copying it sees the tear
+	slot->sequence.store(0, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	for (int y = 0; y < height_; ++y) {
+		memcpy(dst + y * stride, rgba + (height_ - 1 - y) * stride, stride);
+	}
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	slot->timestampNs = uint64_t(now.tv_sec) * 1000000000u + now.tv_nsec;
+	++written_;
+	slot->sequence.store(written_, memory_order_release);
+	header->written.store(written_, memory_order_release);
+}
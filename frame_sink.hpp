@@ -0,0 +1,65 @@
+#ifndef FRAME_SINK_HPP
+#define FRAME_SINK_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/*
+ * Destination of finished frames. write() takes RGBA8 pixels as read
+ * back from the image, bottom row first like GL.
+ */
+class FrameSink {
+public:
+	virtual ~FrameSink() {}
+	virtual void write(const unsigned char* rgba, uint64_t frame) = 0;
+};
+
+/*
+ * Files ending in .y4m get a YUV4MPEG2 4:4:4 stream, anything else raw
+ * RGBA8. Rows are written top to bottom.
+ */
+class FileSink : public FrameSink {
+public:
+	FileSink(const std::string& path, int width, int height);
+	~FileSink();
+
+	FileSink(const FileSink&) = delete;
+	FileSink& operator=(const FileSink&) = delete;
+
+	void write(const unsigned char* rgba, uint64_t frame) override;
+
+private:
+	int width_, height_;
+	bool y4m_;
+	FILE* out_;
+	std::vector<unsigned char> row_;
+};
+
+/*
+ * The producer side of the shared-memory ring SharedMemorySource reads
+ * (ShmRingHeader in input_source.hpp), created or truncated on open and
+ * left in place afterwards for late readers. Rows are stored top first.
+ * Readers that fall behind lose frames, the writer never waits.
+ */
+class SharedMemorySink : public FrameSink {
+public:
+	SharedMemorySink(const std::string& name, int width, int height,
+			int slots = 4);
+	~SharedMemorySink();
+
+	SharedMemorySink(const SharedMemorySink&) = delete;
+	SharedMemorySink& operator=(const SharedMemorySink&) = delete;
+
+	void write(const unsigned char* rgba, uint64_t frame) override;
+
+private:
+	int width_, height_;
+	uint32_t slots_;
+	void* map_ = nullptr;
+	size_t size_ = 0;
+	uint64_t written_ = 0;
+};
+
+#endif
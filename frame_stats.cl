@@ -0,0 +1,89 @@
+// built apart from gl_kernel.cl: STATS_SUBGROUPS is only defined, with
+// the -cl-std the subgroup built-ins need, where the device has them
+#if defined(STATS_SUBGROUPS)
+#pragma OPENCL EXTENSION cl_khr_subgroups : enable
+#endif
+
+// FrameStats::BINS
+#define STATS_BINS 64
+
+/*
+ * Luma statistics of the width x height corner of A, for FrameStats:
+ * result is {min, max, sum, STATS_BINS histogram bins} of 8-bit luma and
+ * has to start as {UINT_MAX, 0, 0, 0...}; the sum fits 16M pixels. Each
+ * work-group reduces its pixels in local memory, with subgroup
+ * reductions first where the device has them, and adds to result with
+ * one atomic per value. scratch holds 3 uints per work-item.
+ */
+__kernel void frame_stats(__read_only image2d_t A, int width, int height,
+		__global uint* result, __local uint* scratch) {
+	const sampler_t nearest = CLK_NORMALIZED_COORDS_FALSE
+		| CLK_ADDRESS_CLAMP_TO_EDGE | CLK_FILTER_NEAREST;
+	__local uint hist[STATS_BINS];
+	uint lid = get_local_id(0);
+	uint lsize = get_local_size(0);
+	for (uint b = lid; b < STATS_BINS; b += lsize) {
+		hist[b] = 0;
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	uint lo = UINT_MAX;
+	uint hi = 0;
+	uint sum = 0;
+	uint n = width * height;
+	for (uint i = get_global_id(0); i < n; i += get_global_size(0)) {
+		float4 c = read_imagef(A, nearest, (int2)(i % width, i / width));
+		uint y = convert_uint_sat_rte(
+				dot(c.xyz, (float3)(0.2126f, 0.7152f, 0.0722f)) * 255.0f);
+		lo = min(lo, y);
+		hi = max(hi, y);
+		sum += y;
+		atomic_inc(&hist[y * STATS_BINS / 256]);
+	}
+
+	// one partial per lane: a subgroup, or each work-item without them
+#if defined(STATS_SUBGROUPS)
+	lo = sub_group_reduce_min(lo);
+	hi = sub_group_reduce_max(hi);
+	sum = sub_group_reduce_add(sum);
+	uint lanes = get_num_sub_groups();
+	uint lane = get_sub_group_id();
+	bool leader = get_sub_group_local_id() == 0;
+#else
+	uint lanes = lsize;
+	uint lane = lid;
+	bool leader = true;
+#endif
+	if (leader) {
+		scratch[lane] = lo;
+		scratch[lanes + lane] = hi;
+		scratch[2 * lanes + lane] = sum;
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	// tree over the lanes, which need not be a power of two
+	uint span = 1;
+	while (span < lanes) {
+		span <<= 1;
+	}
+	for (uint s = span / 2; s > 0; s >>= 1) {
+		if (lid < s && lid + s < lanes) {
+			scratch[lid] = min(scratch[lid], scratch[lid + s]);
+			scratch[lanes + lid] = max(scratch[lanes + lid],
+					scratch[lanes + lid + s]);
+			scratch[2 * lanes + lid] += scratch[2 * lanes + lid + s];
+		}
+		barrier(CLK_LOCAL_MEM_FENCE);
+	}
+
+	if (lid == 0) {
+		atomic_min(&result[0], scratch[0]);
+		atomic_max(&result[1], scratch[lanes]);
+		atomic_add(&result[2], scratch[2 * lanes]);
+	}
+	for (uint b = lid; b < STATS_BINS; b += lsize) {
+		if (hist[b]) {
+			atomic_add(&result[3 + b], hist[b]);
+		}
+	}
+}
@@ -0,0 +1,140 @@
+#include "frame_stats.hpp"
+
+#include <climits>
+#include <cstdio>
+#include <iostream>
+
+#include "cl_setup.hpp"
+
+using namespace std;
+
+// {min, max, sum} and the histogram
+static const size_t RESULT_WORDS = 3 + FrameStats::BINS;
+
+FrameStats::FrameStats(ClArena& arena, const cl::Device& device,
+		const ProgramCache& cache)
+	: arena_(arena), device_(device), clear_(RESULT_WORDS, 0) {
+	setProgram(build(cache));
+
+	// a few groups per unit
+	cl_uint units;
+	device.getInfo(CL_DEVICE_MAX_COMPUTE_UNITS, &units);
+	groups_ = max<cl_uint>(units, 1) * 4;
+
+	clear_[0] = UINT_MAX;
+	for (Slot& s : slots_) {
+		s.result = arena_.buffer(RESULT_WORDS * sizeof(cl_uint),
+				CL_MEM_READ_WRITE);
+		s.staging = arena_.staging(RESULT_WORDS * sizeof(cl_uint));
+	}
+}
+
+FrameStats::~FrameStats() {
+	for (Slot& s : slots_) {
+		arena_.recycle(s.result, s.read);
+		arena_.recycle(s.staging, s.read);
+	}
+}
+
+cl::Program FrameStats::build(const ProgramCache& cache) const {
+	string source = ReadSource("frame_stats.cl");
+
+	// the subgroup built-ins need OpenCL C 2.0 or later
+	string extensions, version;
+	device_.getInfo(CL_DEVICE_EXTENSIONS, &extensions);
+	device_.getInfo(CL_DEVICE_OPENCL_C_VERSION, &version);
+	int major = 1, minor = 2;
+	sscanf(version.c_str(), "OpenCL C %d.%d", &major, &minor);
+	if (extensions.find("cl_khr_subgroups") != string::npos && major >= 2) {
+		string options = "-cl-std=CL" + to_string(major) + "."
+			+ to_string(minor) + " -DSTATS_SUBGROUPS";
+		try {
+			return BuildClProgram(arena_.context(), {device_}, source,
+					cache, options);
+		} catch (cl::Error error) {
+			cerr << "Frame stats without subgroups (" << error.err()
+				<< ")" << endl;
+		}
+	}
+	return BuildClProgram(arena_.context(), {device_}, source, cache);
+}
+
+void FrameStats::reload(const ProgramCache& cache) {
+	setProgram(build(cache));
+}
+
+void FrameStats::setProgram(const cl::Program& program) {
+	kernel_ = cl::Kernel(program, "frame_stats");
+
+	// a power of two up to 256 per work-group, as far as this build of
+	// the kernel allows, which can be less than the device does
+	size_t maxLocal;
+	kernel_.getWorkGroupInfo(device_, CL_KERNEL_WORK_GROUP_SIZE, &maxLocal);
+	local_ = 1;
+	while (local_ * 2 <= min<size_t>(maxLocal, 256)) {
+		local_ *= 2;
+	}
+}
+
+void FrameStats::measure(const cl::CommandQueue& queue,
+		const cl::Image& image, int width, int height, uint64_t frame) {
+	Slot& s = slots_[next_];
+	if (s.busy) {
+		collect(s);
+		if (s.busy) {
+			++skipped_;
+			return;
+		}
+	}
+
+	// the clearing write and the kernel are ordered by the queue
+	queue.enqueueWriteBuffer(s.result, CL_FALSE, 0,
+			RESULT_WORDS * sizeof(cl_uint), clear_.data());
+	kernel_.setArg(0, image);
+	kernel_.setArg(1, width);
+	kernel_.setArg(2, height);
+	kernel_.setArg(3, s.result);
+	kernel_.setArg(4, cl::Local(3 * local_ * sizeof(cl_uint)));
+	queue.enqueueNDRangeKernel(kernel_, cl::NullRange,
+			cl::NDRange(groups_ * local_), cl::NDRange(local_));
+	queue.enqueueReadBuffer(s.result, CL_FALSE, 0,
+			RESULT_WORDS * sizeof(cl_uint), s.staging.host, NULL, &s.read);
+	s.frame = frame;
+	s.pixels = width * height;
+	s.busy = true;
+	next_ ^= 1;
+}
+
+void FrameStats::collect(Slot& s) {
+	cl_int status;
+	s.read.getInfo(CL_EVENT_COMMAND_EXECUTION_STATUS, &status);
+	if (status > CL_COMPLETE) {
+		return;
+	}
+	s.busy = false;
+	// a failed read leaves nothing to take; older results don't replace
+	// a newer one
+	if (status < CL_COMPLETE || (have_ && s.frame < latest_.frame)) {
+		return;
+	}
+	const cl_uint* words = reinterpret_cast<const cl_uint*>(s.staging.host);
+	latest_.frame = s.frame;
+	latest_.minLuma = words[0];
+	latest_.maxLuma = words[1];
+	latest_.averageLuma = s.pixels ? float(words[2]) / s.pixels : 0.f;
+	latest_.histogram.assign(words + 3, words + RESULT_WORDS);
+	have_ = true;
+	++measured_;
+}
+
+bool FrameStats::latest(FrameStatsResult& result) {
+	for (Slot& s : slots_) {
+		if (s.busy) {
+			collect(s);
+		}
+	}
+	if (have_) {
+		result = latest_;
+	}
+	return have_;
+}
@@ -0,0 +1,94 @@
+#ifndef FRAME_STATS_HPP
+#define FRAME_STATS_HPP
+
+#include <cstdint>
+#include <vector>
+
+#define __CL_ENABLE_EXCEPTIONS
+#include "CL/cl.hpp"
+
+#include "cl_arena.hpp"
+#include "program_cache.hpp"
+
+struct FrameStatsResult {
+	uint64_t frame = 0;
+	// 8-bit luma (Rec. 709)
+	unsigned minLuma = 0;
+	unsigned maxLuma = 0;
+	float averageLuma = 0;
+	// FrameStats::BINS bins over 0-255
+	std::vector<uint32_t> histogram;
+};
+
+/*
+ * Luma statistics of the rendered image on the device, for
+ * auto-exposure, without reading the image back: frame_stats.cl runs
+ * after the main kernel and leaves a few hundred bytes in a result
+ * buffer. It is its own program, built with subgroups where the device
+ * has them and with local memory only otherwise, so the main kernel's
+ * build never depends on it.
+ *
+ * Two result buffers alternate. Each one is read into a pinned staging
+ * buffer without blocking and picked up by latest() once that read
+ * completed, normally one frame later. Nothing waits: when both are
+ * still in flight, the frame is not measured and counted as skipped.
+ */
+class FrameStats {
+public:
+	// STATS_BINS in frame_stats.cl
+	static const int BINS = 64;
+
+	FrameStats(ClArena& arena, const cl::Device& device,
+			const ProgramCache& cache);
+	~FrameStats();
+
+	FrameStats(const FrameStats&) = delete;
+	FrameStats& operator=(const FrameStats&) = delete;
+
+	// rebuilds frame_stats.cl; the old kernel stays alive for queued
+	// launches, and stays current when the build fails
+	void reload(const ProgramCache& cache);
+
+	// the width x height corner of image; after the kernel writing it,
+	// while it is acquired on queue
+	void measure(const cl::CommandQueue& queue, const cl::Image& image,
+			int width, int height, uint64_t frame);
+	// the newest result that arrived, false when there is none yet
+	bool latest(FrameStatsResult& result);
+
+	uint64_t measured() const { return measured_; }
+	uint64_t skipped() const { return skipped_; }
+
+private:
+	struct Slot {
+		cl::Buffer result;
+		ClArena::Staging staging;
+		cl::Event read;
+		uint64_t frame = 0;
+		int pixels = 0;
+		bool busy = false;
+	};
+
+	cl::Program build(const ProgramCache& cache) const;
+	void setProgram(const cl::Program& program);
+	// takes slot's result if its read completed
+	void collect(Slot& slot);
+
+	ClArena& arena_;
+	cl::Device device_;
+	cl::Kernel kernel_;
+	// work-group size, for the current kernel
+	size_t local_;
+	size_t groups_;
+	// the initial result, the source of every clearing write
+	std::vector<cl_uint> clear_;
+	Slot slots_[2];
+	int next_ = 0;
+
+	bool have_ = false;
+	FrameStatsResult latest_;
+	uint64_t measured_ = 0;
+	uint64_t skipped_ = 0;
+};
+
+#endif
@@ -1,9 +1,59 @@
-__kernel void glk(__write_only image2d_t A, float x) {
+// no fused multiply-adds: CpuRenderer has to compute the same floats
+#pragma OPENCL FP_CONTRACT OFF
+
+// external frame, top row first and scaled to the render size; a
+// multiply, which is correctly rounded where a division is not
+float4 source_color(__global const uchar4* src, int src_width,
+		int src_height, int idx_x, int idx_y) {
+	int sx = idx_x * src_width / get_global_size(0);
+	int sy = src_height - 1 - idx_y * src_height / get_global_size(1);
+	return convert_float4(src[sy * src_width + sx]) * (1.0f / 255.0f);
+}
+
+// the UNORM8 value write_imagef stores, rounded to nearest even here:
+// the conversion of write_imagef itself may be off by 0.6
+float4 unorm8(float4 c) {
+	return convert_float4(convert_uchar4_sat_rte(c * 255.0f)) / 255.0f;
+}
+
+__kernel void glk(__write_only image2d_t A, float x,
+		__global const uchar4* src, int src_width, int src_height) {
 	// get work-item Unique ID
 	int idx_x = get_global_id(0);
 	int idx_y = get_global_id(1);
 
 	int2 coord = (int2)(idx_x,idx_y);
 	float4 color = (float4)(x,0,1,1);
-	write_imagef(A, coord, color);
+	if (src_width > 0) {
+		color = source_color(src, src_width, src_height, idx_x, idx_y);
+	}
+	write_imagef(A, coord, unorm8(color));
+}
+
+/*
+ * `steps` simulation steps in one launch. The per-pixel state eases
+ * towards the colour of each step, x advancing by dx per step, and only
+ * the last state is written to the image.
+ */
+__kernel void glk_steps(__write_only image2d_t A, float x,
+		__global const uchar4* src, int src_width, int src_height,
+		__global float4* state, float dx, int steps) {
+	int idx_x = get_global_id(0);
+	int idx_y = get_global_id(1);
+	int i = idx_y * get_image_width(A) + idx_x;
+
+	float4 s = state[i];
+	float4 input = (float4)(0,0,0,1);
+	if (src_width > 0) {
+		input = source_color(src, src_width, src_height, idx_x, idx_y);
+	}
+	for (int k = 1; k <= steps; ++k) {
+		float xk = x + k * dx;
+		float4 target = src_width > 0 ? input
+			: (float4)(xk - floor(xk),0,1,1);
+		// mix(), spelled out: it may be evaluated differently
+		s = s + (target - s) * 0.1f;
+	}
+	state[i] = s;
+	write_imagef(A, (int2)(idx_x,idx_y), unorm8(s));
 }
@@ -0,0 +1,268 @@
+#include "gl_present.hpp"
+
+using namespace std;
+
+static const string strVertexShader = R".(
+#version 330
+
+in vec4 position;
+in vec2 inTexCoord;
+
+out vec2 texCoord;
+
+void main()
+{
+	texCoord = inTexCoord;
+	gl_Position = position;
+}
+).";
+
+/*
+ * One triangle covering the whole viewport, the corners outside of it
+ * are clipped away:
+ *
+ * 2
+ * |\
+ * | \
+ * |--\
+ * |  |\
+ * 0 --- 1
+ */
+static const string strFullscreenVertexShader = R".(
+#version 330
+
+out vec2 texCoord;
+
+void main()
+{
+	vec2 p = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+	texCoord = p;
+	gl_Position = vec4(p * 2.0 - 1.0, 0.0, 1.0);
+}
+).";
+
+static const string strFragmentShader = R".(
+#version 330
+
+uniform sampler2D tex;
+// fraction of the texture the kernel rendered into
+uniform vec2 texScale;
+out vec4 outColor;
+
+in vec2 texCoord;
+
+void main()
+{
+	//outColor = vec4(1.0, 0.0, 0.0, 1.0);
+	// keep bilinear taps inside the rendered sub-rectangle, on every
+	// edge: the texture's border colour is not the image
+	vec2 halfTexel = 0.5 / vec2(textureSize(tex, 0));
+	outColor = texture(tex, clamp(texCoord * texScale, halfTexel,
+			texScale - halfTexel));
+}
+).";
+
+Presenter::Presenter(QuadMode mode, bool timeDraws, int drawsPerFrame,
+		const ProgramCache& cache)
+	: mode_(mode), timeDraws_(timeDraws) {
+	ProgramSource source;
+	source.vertex = mode_ == QuadMode::TriangleStrip ?
+		strVertexShader : strFullscreenVertexShader;
+	source.fragment = strFragmentShader;
+	program_ = BuildPrograms({source}, cache)[0];
+
+	texScaleLoc_ = glGetUniformLocation(program_, "texScale");
+	GLint texLoc = glGetUniformLocation(program_, "tex");
+
+	bindProgram();
+	glUniform1i(texLoc, 0);
+	setTexScale(1.f, 1.f);
+
+	// the core profile needs a VAO bound even for attribute-less draws
+	glGenVertexArrays(1, &vao_);
+	bindVertexArray();
+
+	if (mode_ == QuadMode::TriangleStrip) {
+		/*
+		 * 2 ---- 4
+		 * |\     |
+		 * | \    |
+		 * |  \   |
+		 * |   \  |
+		 * |    \ |
+		 * 1 ---- 3
+		 */
+		const GLfloat vertexPositions[] = {
+			// vertex position, texture coords
+			// x, y, z, w, u, v
+			-1.f, -1.f, 0.0f, 1.0f, 0.f, 0.f,
+			-1.f, 1.f, 0.0f, 1.0f, 0.f, 1.f,
+			1.f, -1.f, 0.0f, 1.0f, 1.f, 0.f,
+			1.f, 1.f, 0.0f, 1.0f, 1.f, 1.f
+		};
+
+		glGenBuffers(1, &vbo_);
+		glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+		if (GLEW_ARB_buffer_storage) {
+			glBufferStorage(GL_ARRAY_BUFFER, sizeof(vertexPositions),
+					vertexPositions, 0);
+		} else {
+			glBufferData(GL_ARRAY_BUFFER, sizeof(vertexPositions),
+					vertexPositions, GL_STATIC_DRAW);
+		}
+
+		GLint posAttrib = glGetAttribLocation(program_, "position");
+		GLint texAttrib = glGetAttribLocation(program_, "inTexCoord");
+
+		glEnableVertexAttribArray(posAttrib);
+		glEnableVertexAttribArray(texAttrib);
+
+		glVertexAttribPointer(posAttrib, 4, GL_FLOAT, GL_FALSE,
+				6*sizeof(GLfloat), 0);
+		glVertexAttribPointer(texAttrib, 2, GL_FLOAT, GL_FALSE,
+				6*sizeof(GLfloat), (void*)(4*sizeof(GLfloat)));
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	glActiveTexture(GL_TEXTURE0);
+
+	if (timeDraws_) {
+		queries_.resize(drawsPerFrame * 2);
+		queryPending_.resize(queries_.size(), false);
+		glGenQueries(GLsizei(queries_.size()), queries_.data());
+	}
+}
+
+Presenter::~Presenter() {
+	if (timeDraws_) {
+		glDeleteQueries(GLsizei(queries_.size()), queries_.data());
+	}
+	glBindVertexArray(0);
+	glUseProgram(0);
+	glDeleteVertexArrays(1, &vao_);
+	if (vbo_) {
+		glDeleteBuffers(1, &vbo_);
+	}
+	glDeleteProgram(program_);
+}
+
+void Presenter::setTexScale(float sx, float sy) {
+	if (sx == texScale_[0] && sy == texScale_[1]) {
+		return;
+	}
+	bindProgram();
+	glUniform2f(texScaleLoc_, sx, sy);
+	texScale_[0] = sx;
+	texScale_[1] = sy;
+}
+
+void Presenter::draw(GLuint tex) {
+	bindProgram();
+	bindVertexArray();
+	bindTexture(tex);
+
+	GLuint query = timeDraws_ ? queries_[queryIdx_] : 0;
+	if (timeDraws_) {
+		GLuint available = GL_FALSE;
+		if (queryPending_[queryIdx_]) {
+			glGetQueryObjectuiv(query, GL_QUERY_RESULT_AVAILABLE,
+					&available);
+		}
+		if (available) {
+			GLuint64 ns;
+			glGetQueryObjectui64v(query, GL_QUERY_RESULT, &ns);
+			timedNanos_ += ns;
+			++timedDraws_;
+			totalNanos_ += ns;
+			++totalDraws_;
+		}
+		glBeginQuery(GL_TIME_ELAPSED, query);
+	}
+
+	if (mode_ == QuadMode::TriangleStrip) {
+		glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	} else {
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+	}
+
+	if (timeDraws_) {
+		glEndQuery(GL_TIME_ELAPSED);
+		queryPending_[queryIdx_] = true;
+		queryIdx_ = (queryIdx_ + 1) % queries_.size();
+	}
+}
+
+double Presenter::takeAverageDrawMicros() {
+	double avg = timedDraws_ ? timedNanos_ / 1000.0 / timedDraws_ : 0.0;
+	timedNanos_ = 0;
+	timedDraws_ = 0;
+	return avg;
+}
+
+double Presenter::averageDrawMicros() const {
+	return totalDraws_ ? totalNanos_ / 1000.0 / totalDraws_ : 0.0;
+}
+
+void Presenter::bindProgram() {
+	if (boundProgram_ != program_) {
+		glUseProgram(program_);
+		boundProgram_ = program_;
+	}
+}
+
+void Presenter::bindVertexArray() {
+	if (boundVao_ != vao_) {
+		glBindVertexArray(vao_);
+		boundVao_ = vao_;
+	}
+}
+
+void Presenter::bindTexture(GLuint tex) {
+	if (boundTex_ != tex) {
+		glBindTexture(GL_TEXTURE_2D, tex);
+		boundTex_ = tex;
+	}
+}
+
+PboTexture::PboTexture(int width, int height)
+	: width_(width), height_(height) {
+	glGenTextures(1, &tex_);
+	glBindTexture(GL_TEXTURE_2D, tex_);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width_, height_, 0, GL_RGBA,
+			GL_UNSIGNED_BYTE, NULL);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glGenBuffers(2, pbos_);
+}
+
+PboTexture::~PboTexture() {
+	glDeleteBuffers(2, pbos_);
+	glDeleteTextures(1, &tex_);
+}
+
+void PboTexture::update(const function<void(unsigned char*, size_t)>& fill) {
+	size_t stride = size_t(width_) * 4;
+	size_t size = stride * height_;
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbos_[next_]);
+	// orphaned, a pending upload from the old storage doesn't block
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+	void* p = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+			GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	if (p) {
+		fill(static_cast<unsigned char*>(p), stride);
+	}
+	if (glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) && p) {
+		// Presenter skips redundant binds, put its binding back
+		GLint bound;
+		glGetIntegerv(GL_TEXTURE_BINDING_2D, &bound);
+		glBindTexture(GL_TEXTURE_2D, tex_);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width_, height_, GL_RGBA,
+				GL_UNSIGNED_BYTE, 0);
+		glBindTexture(GL_TEXTURE_2D, bound);
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	next_ = 1 - next_;
+}
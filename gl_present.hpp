@@ -0,0 +1,102 @@
+#ifndef GL_PRESENT_HPP
+#define GL_PRESENT_HPP
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "program_cache.hpp"
+
+enum class QuadMode {
+	// 4 vertices from a VBO, drawn as GL_TRIANGLE_STRIP
+	TriangleStrip,
+	// 3 vertices generated from gl_VertexID, no VBO
+	FullscreenTriangle
+};
+
+/*
+ * Everything needed to put the shared texture on screen.
+ *
+ * All GL objects, attribute and uniform locations are set up once in
+ * the constructor and recorded in a VAO, so a frame is only
+ * bind (skipped when already bound) + draw. Needs a current context.
+ */
+class Presenter {
+public:
+	// drawsPerFrame sizes the --time-draws query ring
+	Presenter(QuadMode mode, bool timeDraws, int drawsPerFrame,
+			const ProgramCache& cache);
+	~Presenter();
+
+	Presenter(const Presenter&) = delete;
+	Presenter& operator=(const Presenter&) = delete;
+
+	// fraction of the texture the kernel rendered into
+	void setTexScale(float sx, float sy);
+	void draw(GLuint tex);
+
+	// average GPU time of draw() since the last call, 0 if not timed
+	double takeAverageDrawMicros();
+	// the same over the whole run
+	double averageDrawMicros() const;
+	uint64_t timedDraws() const { return totalDraws_; }
+
+	QuadMode mode() const { return mode_; }
+
+private:
+	void bindProgram();
+	void bindVertexArray();
+	void bindTexture(GLuint tex);
+
+	QuadMode mode_;
+	GLuint program_ = 0;
+	GLuint vao_ = 0;
+	GLuint vbo_ = 0;
+	GLint texScaleLoc_ = -1;
+
+	// what is bound right now, so redundant binds can be skipped
+	GLuint boundProgram_ = 0;
+	GLuint boundVao_ = 0;
+	GLuint boundTex_ = 0;
+	float texScale_[2] = {-1.f, -1.f};
+
+	// GL_TIME_ELAPSED queries, two frames' worth, read back once
+	// available so they never stall; a result that isn't is dropped
+	bool timeDraws_;
+	std::vector<GLuint> queries_;
+	std::vector<char> queryPending_;
+	size_t queryIdx_ = 0;
+	GLuint64 timedNanos_ = 0;
+	int timedDraws_ = 0;
+	GLuint64 totalNanos_ = 0;
+	uint64_t totalDraws_ = 0;
+};
+
+/*
+ * An RGBA8 texture filled from the CPU through two pixel unpack buffers.
+ * update() maps the next one, lets fill write the frame straight into it
+ * (rows bottom first, as in GL) and uploads from it, so there is no
+ * extra host copy and the previous upload may still be in flight.
+ */
+class PboTexture {
+public:
+	PboTexture(int width, int height);
+	~PboTexture();
+
+	PboTexture(const PboTexture&) = delete;
+	PboTexture& operator=(const PboTexture&) = delete;
+
+	void update(const std::function<void(unsigned char* rgba,
+				size_t stride)>& fill);
+	GLuint texture() const { return tex_; }
+
+private:
+	int width_, height_;
+	GLuint tex_ = 0;
+	GLuint pbos_[2] = {0, 0};
+	int next_ = 0;
+};
+
+#endif
@@ -0,0 +1,244 @@
+#include "input_source.hpp"
+
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+static void* map_readonly(int fd, size_t& size, const string& what) {
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		close(fd);
+		throw runtime_error{"cannot stat " + what};
+	}
+	size = st.st_size;
+	void* p = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED) {
+		throw runtime_error{"cannot map " + what};
+	}
+	return p;
+}
+
+MappedFileSource::MappedFileSource(const string& path, int width,
+		int height, double fps)
+	: frameSize_(size_t(width) * height * 4), fps_(fps),
+	start_(chrono::steady_clock::now()) {
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw runtime_error{"cannot open " + path};
+	}
+	data_ = static_cast<const unsigned char*>(map_readonly(fd, size_, path));
+	frames_ = size_ / frameSize_;
+	if (frames_ == 0) {
+		munmap(const_cast<unsigned char*>(data_), size_);
+		throw runtime_error{path + " holds no complete frame"};
+	}
+	// read ahead, playback is sequential
+	madvise(const_cast<unsigned char*>(data_), size_, MADV_SEQUENTIAL);
+}
+
+MappedFileSource::~MappedFileSource() {
+	munmap(const_cast<unsigned char*>(data_), size_);
+}
+
+bool MappedFileSource::latest(InputFrame& frame) {
+	auto elapsed = chrono::steady_clock::now() - start_;
+	uint64_t ns = chrono::duration_cast<chrono::nanoseconds>(elapsed).count();
+	uint64_t n = uint64_t(ns * 1e-9 * fps_);
+	if (last_ != UINT64_MAX && n > last_ + 1) {
+		dropped_ += n - last_ - 1;
+	}
+	last_ = n;
+
+	frame.index = n;
+	frame.timestampNs = chrono::duration_cast<chrono::nanoseconds>(
+			start_.time_since_epoch()).count() + uint64_t(n * 1e9 / fps_);
+	frame.pixels = data_ + (n % frames_) * frameSize_;
+	return true;
+}
+
+SharedMemorySource::SharedMemorySource(const string& name, int width,
+		int height)
+	: frameSize_(size_t(width) * height * 4) {
+	int fd = shm_open(name.c_str(), O_RDONLY, 0);
+	if (fd < 0) {
+		throw runtime_error{"cannot open shared memory " + name};
+	}
+	map_ = map_readonly(fd, size_, name);
+	header_ = static_cast<const ShmRingHeader*>(map_);
+
+	if (size_ < sizeof(ShmRingHeader)
+			|| header_->magic != ShmRingHeader::MAGIC
+			|| header_->width != uint32_t(width)
+			|| header_->height != uint32_t(height)
+			|| header_->slots == 0
+			|| size_ < ShmFramesOffset(header_->slots)
+			+ header_->slots * frameSize_) {
+		munmap(map_, size_);
+		throw runtime_error{name + " is not a matching frame ring"};
+	}
+	frames_ = static_cast<const unsigned char*>(map_)
+		+ ShmFramesOffset(header_->slots);
+}
+
+SharedMemorySource::~SharedMemorySource() {
+	munmap(map_, size_);
+}
+
+const ShmSlotHeader& SharedMemorySource::slot(uint64_t n) const {
+	const ShmSlotHeader* slots = reinterpret_cast<const ShmSlotHeader*>(
+			static_cast<const unsigned char*>(map_)
+			+ sizeof(ShmRingHeader));
+	return slots[n % header_->slots];
+}
+
+bool SharedMemorySource::latest(InputFrame& frame) {
+	uint64_t written = header_->written.load(memory_order_acquire);
+	if (written == 0) {
+		return false;
+	}
+	uint64_t n = written - 1;
+	// already being overwritten, the producer lapped us
+	if (slot(n).sequence.load(memory_order_acquire) != n + 1) {
+		return false;
+	}
+	if (last_ != UINT64_MAX && written > last_ + 1) {
+		dropped_ += written - last_ - 1;
+	}
+	last_ = written;
+
+	frame.index = n;
+	frame.timestampNs = slot(n).timestampNs;
+	frame.pixels = frames_ + (n % header_->slots) * frameSize_;
+	return true;
+}
+
+bool SharedMemorySource::stillValid(const InputFrame& frame) const {
+	// the reads of the pixels must not move past the sequence load
+	atomic_thread_fence(memory_order_acquire);
+	return slot(frame.index).sequence.load(memory_order_relaxed)
+		== frame.index + 1;
+}
+
+InputStream::InputStream(ClArena& arena, const cl::Device& device,
+		unique_ptr<InputSource> source, int width, int height)
+	: arena_(arena), source_(move(source)),
+	uploadQueue_(arena.context(), device),
+	size_(size_t(width) * height * 4) {
+	if (source_->mapping()) {
+		mapInPlace(device);
+	}
+	for (Slot& s : slots_) {
+		// only for frames that can't be read in place
+		s.pinned = arena_.buffer(size_,
+				CL_MEM_READ_ONLY | CL_MEM_ALLOC_HOST_PTR);
+		s.buffer = s.pinned;
+	}
+	// a first frame, black when the source has nothing yet
+	if (!upload(slots_[cur_])) {
+		uploadQueue_.enqueueFillBuffer(slots_[cur_].buffer,
+				(cl_uchar)0, 0, size_);
+	}
+	uploadQueue_.finish();
+}
+
+InputStream::~InputStream() {
+	uploadQueue_.finish();
+	for (Slot& s : slots_) {
+		arena_.recycle(s.pinned,
+				s.lastUse.empty() ? cl::Event() : s.lastUse[0]);
+	}
+}
+
+void InputStream::mapInPlace(const cl::Device& device) {
+	cl_ulong maxAlloc;
+	device.getInfo(CL_DEVICE_MAX_MEM_ALLOC_SIZE, &maxAlloc);
+	if (source_->mappingSize() > maxAlloc) {
+		cerr << "Input is copied, it is larger than the device's "
+			"largest buffer" << endl;
+		return;
+	}
+	cl_uint alignBits;
+	device.getInfo(CL_DEVICE_MEM_BASE_ADDR_ALIGN, &alignBits);
+	size_t align = max<size_t>(alignBits / 8, 1);
+	try {
+		// read only: the mapping is PROT_READ and never changes, a
+		// device that keeps its own copy of it doesn't go stale
+		mapped_ = cl::Buffer(arena_.context(),
+				CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR,
+				source_->mappingSize(),
+				const_cast<unsigned char*>(source_->mapping()));
+		// all of them now, none are created while streaming
+		frameBuffers_.resize(source_->mappingSize() / size_);
+		for (size_t i = 0; i < frameBuffers_.size(); ++i) {
+			cl_buffer_region region = {i * size_, size_};
+			if (region.origin % align == 0) {
+				frameBuffers_[i] = mapped_.createSubBuffer(
+						CL_MEM_READ_ONLY, CL_BUFFER_CREATE_TYPE_REGION,
+						&region);
+			}
+		}
+	} catch (cl::Error error) {
+		cerr << "Input is copied, the device can't map it ("
+			<< error.err() << ")" << endl;
+		frameBuffers_.clear();
+		mapped_ = cl::Buffer();
+	}
+}
+
+bool InputStream::upload(Slot& slot) {
+	InputFrame f;
+	if (!source_->latest(f)) {
+		return false;
+	}
+	const Slot& cur = slots_[cur_];
+	if (cur.frame.pixels && f.index == cur.frame.index) {
+		return false;
+	}
+
+	size_t frame = frameBuffers_.empty() ? 0
+		: (f.pixels - source_->mapping()) / size_;
+	if (frame < frameBuffers_.size() && frameBuffers_[frame]()) {
+		slot.buffer = frameBuffers_[frame];
+		slot.ready.clear();
+		slot.frame = f;
+		++uploaded_;
+		++inPlace_;
+		return true;
+	}
+
+	// waits for the kernel that last read this buffer, nothing else
+	slot.buffer = slot.pinned;
+	void* p = uploadQueue_.enqueueMapBuffer(slot.buffer, CL_TRUE,
+			CL_MAP_WRITE_INVALIDATE_REGION, 0, size_, &slot.lastUse);
+	memcpy(p, f.pixels, size_);
+	bool intact = source_->stillValid(f);
+
+	cl::Event unmapped;
+	uploadQueue_.enqueueUnmapMemObject(slot.buffer, p, NULL, &unmapped);
+	uploadQueue_.flush();
+	if (!intact) {
+		++torn_;
+		return false;
+	}
+
+	slot.ready.assign(1, unmapped);
+	slot.frame = f;
+	++uploaded_;
+	return true;
+}
+
+void InputStream::advance(const cl::Event& consumed) {
+	slots_[cur_].lastUse.assign(1, consumed);
+
+	int next = 1 - cur_;
+	if (upload(slots_[next])) {
+		cur_ = next;
+	}
+}
@@ -0,0 +1,191 @@
+#ifndef INPUT_SOURCE_HPP
+#define INPUT_SOURCE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#define __CL_ENABLE_EXCEPTIONS
+#include "CL/cl.hpp"
+
+#include "cl_arena.hpp"
+
+/*
+ * External frames fed to the kernel. Pixels are RGBA8, rows top to
+ * bottom, the same size as the window.
+ */
+struct InputFrame {
+	const unsigned char* pixels = nullptr;
+	uint64_t index = 0;
+	// steady clock (CLOCK_MONOTONIC) ns: stamped by the producer for
+	// shared memory, when the frame became due for files
+	uint64_t timestampNs = 0;
+};
+
+class InputSource {
+public:
+	virtual ~InputSource() {}
+
+	// the most recent frame, false when there is none yet
+	virtual bool latest(InputFrame& frame) = 0;
+	// true when the frame returned by latest() is still intact; a ring
+	// slot may have been overwritten while it was being copied
+	virtual bool stillValid(const InputFrame& frame) const { return true; }
+	// frames that were skipped because a newer one was available
+	virtual uint64_t dropped() const = 0;
+	// the page-aligned mapping every frame's pixels point into, when
+	// its contents never change; null when frames must be copied
+	virtual const unsigned char* mapping() const { return nullptr; }
+	virtual size_t mappingSize() const { return 0; }
+};
+
+/*
+ * A raw file of back-to-back frames, memory-mapped and played back at a
+ * fixed rate, looping. Frames the consumer was too slow for are skipped
+ * and counted as dropped.
+ */
+class MappedFileSource : public InputSource {
+public:
+	MappedFileSource(const std::string& path, int width, int height,
+			double fps);
+	~MappedFileSource();
+
+	bool latest(InputFrame& frame) override;
+	uint64_t dropped() const override { return dropped_; }
+	const unsigned char* mapping() const override { return data_; }
+	size_t mappingSize() const override { return size_; }
+
+private:
+	const unsigned char* data_ = nullptr;
+	size_t size_ = 0;
+	size_t frameSize_;
+	uint64_t frames_;
+	double fps_;
+	std::chrono::steady_clock::time_point start_;
+	uint64_t last_ = UINT64_MAX;
+	uint64_t dropped_ = 0;
+};
+
+/*
+ * Layout of the POSIX shared-memory ring another local process writes
+ * into (shm_open name): the header, then `slots` ShmSlotHeaders, then
+ * from ShmFramesOffset(slots) on, page aligned, `slots` frames. The
+ * producer stores 0 to slot (n % slots)'s ShmSlotHeader::sequence, fills
+ * the slot, sets its sequence to n + 1 and then stores n + 1 to written.
+ * timestampNs is CLOCK_MONOTONIC, for the input-to-present latency.
+ */
+struct ShmRingHeader {
+	static const uint32_t MAGIC = 0x4c43474f; // "OGCL"
+	uint32_t magic;
+	uint32_t width;
+	uint32_t height;
+	uint32_t slots;
+	std::atomic<uint64_t> written;
+};
+
+struct ShmSlotHeader {
+	std::atomic<uint64_t> sequence;
+	uint64_t timestampNs;
+};
+
+// where the frames start, page aligned
+inline size_t ShmFramesOffset(uint32_t slots) {
+	size_t headers = sizeof(ShmRingHeader) + slots * sizeof(ShmSlotHeader);
+	return (headers + 4095) & ~size_t(4095);
+}
+
+class SharedMemorySource : public InputSource {
+public:
+	SharedMemorySource(const std::string& name, int width, int height);
+	~SharedMemorySource();
+
+	bool latest(InputFrame& frame) override;
+	bool stillValid(const InputFrame& frame) const override;
+	uint64_t dropped() const override { return dropped_; }
+
+private:
+	const ShmSlotHeader& slot(uint64_t n) const;
+
+	void* map_ = nullptr;
+	size_t size_ = 0;
+	const ShmRingHeader* header_ = nullptr;
+	const unsigned char* frames_ = nullptr;
+	size_t frameSize_;
+	// what written was on the last call; a running ring's backlog
+	// before it is not dropped
+	uint64_t last_ = UINT64_MAX;
+	uint64_t dropped_ = 0;
+};
+
+/*
+ * Streams an InputSource to the device, one frame ahead of the kernel.
+ *
+ * Frames are copied into two pinned (CL_MEM_ALLOC_HOST_PTR) buffers
+ * that alternate, advance() fills the one the kernel isn't reading
+ * through its own queue. A ring slot the producer overwrote during the
+ * copy is counted as dropped and the previous frame stays current.
+ *
+ * A source whose mapping never changes (a file) is wrapped in one
+ * CL_MEM_USE_HOST_PTR buffer instead when the device can allocate it
+ * whole, with a sub-buffer per frame created up front: the kernel reads
+ * those in place. Frames at an offset that isn't a multiple of
+ * CL_DEVICE_MEM_BASE_ADDR_ALIGN are still copied.
+ */
+class InputStream {
+public:
+	InputStream(ClArena& arena, const cl::Device& device,
+			std::unique_ptr<InputSource> source, int width, int height);
+	~InputStream();
+
+	InputStream(const InputStream&) = delete;
+	InputStream& operator=(const InputStream&) = delete;
+
+	const cl::Buffer& current() const { return slots_[cur_].buffer; }
+	// completes when current() holds its frame, for the kernel's wait list
+	const std::vector<cl::Event>& currentReady() const {
+		return slots_[cur_].ready;
+	}
+	// index and timestamp of the frame in current()
+	const InputFrame& currentFrame() const { return slots_[cur_].frame; }
+
+	// stage the next frame and make it current; consumed is the kernel
+	// reading current(), a copy doesn't overwrite it before it completes
+	void advance(const cl::Event& consumed);
+
+	uint64_t uploaded() const { return uploaded_; }
+	// frames the kernel read in place, the others were copied
+	uint64_t inPlace() const { return inPlace_; }
+	uint64_t dropped() const { return source_->dropped() + torn_; }
+
+private:
+	struct Slot {
+		// what the kernel reads: one of inPlace_, or pinned
+		cl::Buffer buffer;
+		cl::Buffer pinned;
+		std::vector<cl::Event> ready;
+		std::vector<cl::Event> lastUse;
+		InputFrame frame;
+	};
+
+	bool upload(Slot& slot);
+	void mapInPlace(const cl::Device& device);
+
+	ClArena& arena_;
+	std::unique_ptr<InputSource> source_;
+	cl::CommandQueue uploadQueue_;
+	size_t size_;
+	cl::Buffer mapped_;
+	// a sub-buffer of mapped_ per frame of the mapping, null where the
+	// frame isn't aligned
+	std::vector<cl::Buffer> frameBuffers_;
+	Slot slots_[2];
+	int cur_ = 0;
+	std::atomic<uint64_t> uploaded_{0};
+	std::atomic<uint64_t> inPlace_{0};
+	std::atomic<uint64_t> torn_{0};
+};
+
+#endif
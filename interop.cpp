@@ -0,0 +1,143 @@
+#include "interop.hpp"
+
+#include <algorithm>
+
+#include "cl_setup.hpp"
+
+using namespace std;
+
+SharedTexture::SharedTexture(const cl::Context& context, int width,
+		int height)
+	: context_(context), width_(width), height_(height) {
+	create();
+}
+
+SharedTexture::~SharedTexture() {
+	lock_guard<mutex> lk(m_);
+	release();
+}
+
+void SharedTexture::create() {
+	glGenTextures(1, &tex_);
+	glBindTexture(GL_TEXTURE_2D, tex_);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+	GLfloat red_color[] = { 1.0f, 0.5f, 0.0f, 1.0f };
+	glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, red_color);
+	// linear, the kernel may render below full resolution
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	// RGBA8, what the kernel, capture and readers expect
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width_, height_, 0, GL_RGBA,
+			GL_UNSIGNED_BYTE, NULL);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	// GL has to be done with the texture before CL takes it, but only
+	// with this texture: a fence instead of glFinish()
+	GLsync created = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	glClientWaitSync(created, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+	glDeleteSync(created);
+
+	// read too by --frame-stats
+	image_ = cl::ImageGL{context_, CL_MEM_READ_WRITE, GL_TEXTURE_2D, 0, tex_};
+	objs_.assign(1, image_);
+}
+
+void SharedTexture::release() {
+	if (clDone_()) {
+		clDone_.wait();
+		clDone_ = cl::Event();
+	}
+	// I """"HAVE TO"""" release OpenCL resources
+	// """"BEFORE"""" OpenGL resources T_T
+	objs_.clear();
+	image_ = cl::ImageGL();
+	glDeleteTextures(1, &tex_);
+	tex_ = 0;
+}
+
+void SharedTexture::clUsed(const cl::Event& done) {
+	clDone_ = done;
+}
+
+InteropContext::InteropContext(const cl::Platform& platform,
+		cl_context_properties* cl_properties) {
+	devices_.push_back(GetGLInteropDevice(platform, cl_properties));
+	context_ = cl::Context(devices_, cl_properties);
+	// Create a command Queue for the first device
+	queue_ = cl::CommandQueue(context_, devices_[0],
+			CL_QUEUE_PROFILING_ENABLE);
+	arena_.reset(new ClArena(context_, queue_));
+
+	string extensions;
+	devices_[0].getInfo(CL_DEVICE_EXTENSIONS, &extensions);
+	if (extensions.find("cl_khr_gl_event") != string::npos) {
+		createEventFromGLsync_ = (clCreateEventFromGLsyncKHR_fn)
+			clGetExtensionFunctionAddressForPlatform(platform(),
+					"clCreateEventFromGLsyncKHR");
+	}
+}
+
+InteropContext::~InteropContext() {
+	for (auto& f : fences_) {
+		f.second.wait();
+		glDeleteSync(f.first);
+	}
+	// the rest goes in reverse declaration order, see the class comment
+	textures_.clear();
+}
+
+void InteropContext::setProgram(const cl::Program& program,
+		const char* name) {
+	vector<cl::Kernel> kernels;
+	for (size_t i = 0; i < max<size_t>(textures_.size(), 1); ++i) {
+		kernels.push_back(cl::Kernel(program, name));
+	}
+	kernels_.swap(kernels);
+	program_ = program;
+	kernelName_ = name;
+}
+
+SharedTexture& InteropContext::addTexture(int width, int height) {
+	textures_.emplace_back(new SharedTexture(context_, width, height));
+	if (program_() && kernels_.size() < textures_.size()) {
+		kernels_.push_back(cl::Kernel(program_, kernelName_.c_str()));
+	}
+	return *textures_.back();
+}
+
+void InteropContext::drawn() {
+	if (!createEventFromGLsync_) {
+		return;
+	}
+	// a fence is only deleted once its event is done with it
+	size_t done = 0;
+	while (done < fences_.size()) {
+		cl_int status;
+		fences_[done].second.getInfo(CL_EVENT_COMMAND_EXECUTION_STATUS,
+				&status);
+		if (status > CL_COMPLETE) {
+			break;
+		}
+		glDeleteSync(fences_[done].first);
+		++done;
+	}
+	fences_.erase(fences_.begin(), fences_.begin() + done);
+
+	GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	cl_int err;
+	cl_event e = createEventFromGLsync_(context_(), (cl_GLsync)fence, &err);
+	if (err != CL_SUCCESS) {
+		glDeleteSync(fence);
+		return;
+	}
+	cl::Event event(e);
+	fences_.push_back(make_pair(fence, event));
+	lock_guard<mutex> lk(drawnMutex_);
+	drawn_ = event;
+}
+
+vector<cl::Event> InteropContext::glDrawn() {
+	lock_guard<mutex> lk(drawnMutex_);
+	return drawn_() ? vector<cl::Event>(1, drawn_) : vector<cl::Event>();
+}
@@ -0,0 +1,125 @@
+#ifndef INTEROP_HPP
+#define INTEROP_HPP
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+#define __CL_ENABLE_EXCEPTIONS
+#include "CL/cl.hpp"
+
+#include "cl_arena.hpp"
+
+/*
+ * A GL texture and the cl::ImageGL aliasing it, released in the only
+ * valid order: the CL image first, then the GL texture.
+ *
+ * The last CL command touching it is tracked, so destroying it waits
+ * for that and nothing else; GL keeps the texture alive for draws still
+ * queued. Hold lock() while enqueueing work on image() from another
+ * thread.
+ */
+class SharedTexture {
+public:
+	SharedTexture(const cl::Context& context, int width, int height);
+	~SharedTexture();
+
+	SharedTexture(const SharedTexture&) = delete;
+	SharedTexture& operator=(const SharedTexture&) = delete;
+
+	GLuint texture() const { return tex_; }
+	const cl::ImageGL& image() const { return image_; }
+	// for enqueue{Acquire,Release}GLObjects
+	const std::vector<cl::Memory>& objects() const { return objs_; }
+	int width() const { return width_; }
+	int height() const { return height_; }
+
+	std::mutex& lock() { return m_; }
+
+	// completion of the last CL command on image(), usually the release
+	void clUsed(const cl::Event& done);
+
+private:
+	void create();
+	void release();
+
+	cl::Context context_;
+	int width_, height_;
+	GLuint tex_ = 0;
+	cl::ImageGL image_;
+	std::vector<cl::Memory> objs_;
+
+	std::mutex m_;
+	cl::Event clDone_;
+};
+
+/*
+ * The OpenCL side of the interop: context, queue, arena, program and the
+ * shared textures, owned together. Every texture gets its own instance
+ * of the kernel, so each can have its own arguments.
+ *
+ * Members are declared in dependency order, so destruction releases the
+ * textures first (each CL image before its GL texture), then kernel,
+ * program, arena, queue and context. It has to be destroyed while the GL
+ * context is still current, and before it.
+ */
+class InteropContext {
+public:
+	// the device driving the GL context described by cl_properties
+	InteropContext(const cl::Platform& platform,
+			cl_context_properties* cl_properties);
+	~InteropContext();
+
+	InteropContext(const InteropContext&) = delete;
+	InteropContext& operator=(const InteropContext&) = delete;
+
+	const cl::Context& context() const { return context_; }
+	const std::vector<cl::Device>& devices() const { return devices_; }
+	cl::CommandQueue& queue() { return queue_; }
+	ClArena& arena() { return *arena_; }
+
+	/*
+	 * Makes `name` from program the kernel, also to reload it at
+	 * runtime: launches already queued keep the previous kernel alive,
+	 * so there is nothing to drain. Arguments have to be set again.
+	 */
+	void setProgram(const cl::Program& program, const char* name);
+	const cl::Program& program() const { return program_; }
+	// the instance for texture(i)
+	cl::Kernel& kernel(size_t i = 0) { return kernels_[i]; }
+
+	SharedTexture& addTexture(int width, int height);
+	SharedTexture& texture(size_t i) { return *textures_[i]; }
+	size_t textureCount() const { return textures_.size(); }
+
+	/*
+	 * Render thread, once per frame after its last draw from the
+	 * textures and before the swap that flushes it: one GL fence, turned
+	 * into an event with cl_khr_gl_event. The manager passes glDrawn()
+	 * to the acquire, so the kernel doesn't write a texture GL is still
+	 * reading. Without the extension it is empty and the acquire relies
+	 * on the driver's implicit synchronization.
+	 */
+	void drawn();
+	std::vector<cl::Event> glDrawn();
+
+private:
+	cl::Context context_;
+	std::vector<cl::Device> devices_;
+	cl::CommandQueue queue_;
+	std::unique_ptr<ClArena> arena_;
+	cl::Program program_;
+	std::string kernelName_;
+	std::vector<cl::Kernel> kernels_;
+	std::vector<std::unique_ptr<SharedTexture> > textures_;
+
+	clCreateEventFromGLsyncKHR_fn createEventFromGLsync_ = nullptr;
+	std::mutex drawnMutex_;
+	cl::Event drawn_;
+	// fences whose events may still be waited on, oldest first
+	std::vector<std::pair<GLsync, cl::Event> > fences_;
+};
+
+#endif
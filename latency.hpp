@@ -0,0 +1,95 @@
+#ifndef LATENCY_HPP
+#define LATENCY_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+/*
+ * Running average and maximum of a latency, plus the same over the
+ * interval since the last take() for the window title.
+ */
+class LatencyStats {
+public:
+	void add(std::chrono::microseconds latency) {
+		int64_t us = latency.count();
+		total_ += us;
+		max_ = std::max(max_, us);
+		++count_;
+		interval_ += us;
+		++intervalCount_;
+	}
+
+	uint64_t count() const { return count_; }
+	int64_t averageMicros() const {
+		return count_ ? total_ / int64_t(count_) : 0;
+	}
+	int64_t maxMicros() const { return max_; }
+
+	// average since the previous call
+	int64_t takeAverageMicros() {
+		int64_t avg = intervalCount_ ? interval_ / intervalCount_ : 0;
+		interval_ = 0;
+		intervalCount_ = 0;
+		return avg;
+	}
+
+private:
+	int64_t total_ = 0;
+	int64_t max_ = 0;
+	uint64_t count_ = 0;
+	int64_t interval_ = 0;
+	int64_t intervalCount_ = 0;
+};
+
+/*
+ * Picks when to latch the parameters of the next frame so that it is
+ * ready just before the next present: the last present, plus the
+ * present interval, minus the time from latch to ready, minus a margin.
+ * Both durations are smoothed; the work estimate rises immediately so a
+ * slow frame doesn't make the next one miss too.
+ */
+class LatchScheduler {
+public:
+	typedef std::chrono::steady_clock clock;
+
+	explicit LatchScheduler(std::chrono::microseconds margin =
+			std::chrono::microseconds(1000))
+		: margin_(margin) {}
+
+	void presented(clock::time_point when) {
+		if (when <= last_) {
+			return;
+		}
+		if (last_ != clock::time_point()) {
+			double t = std::chrono::duration<double, std::micro>(
+					when - last_).count();
+			interval_us_ = interval_us_ <= 0 ? t
+				: interval_us_ + 0.1 * (t - interval_us_);
+		}
+		last_ = when;
+	}
+
+	void frameTook(std::chrono::microseconds work) {
+		double t = static_cast<double>(work.count());
+		work_us_ = t > work_us_ ? t : work_us_ + 0.1 * (t - work_us_);
+	}
+
+	// in the past (latch now) until two presents were seen
+	clock::time_point latchAt() const {
+		if (interval_us_ <= 0) {
+			return clock::time_point();
+		}
+		auto lead = std::chrono::microseconds(
+				int64_t(interval_us_ - work_us_)) - margin_;
+		return last_ + std::max(lead, std::chrono::microseconds(0));
+	}
+
+private:
+	std::chrono::microseconds margin_;
+	clock::time_point last_;
+	double interval_us_ = 0;
+	double work_us_ = 0;
+};
+
+#endif
@@ -0,0 +1,121 @@
+#include "options.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+static void usage(const char* prog) {
+	cerr << "Usage: " << prog << " [options]\n"
+		<< "  --fullscreen-triangle  present with a single triangle\n"
+		<< "  --time-draws           measure the GPU time of each draw\n"
+		<< "  --capture FILE         stream frames to FILE (.y4m or raw)\n"
+		<< "  --capture-depth N      frames in flight to the writer\n"
+		<< "  --input FILE           raw RGBA8 frames fed to the kernel\n"
+		<< "  --input-fps F          playback rate of --input\n"
+		<< "  --input-shm NAME       frames from a shared-memory ring\n"
+		<< "  --low-latency          latch late, one frame in flight\n"
+		<< "  --steps-per-frame M    simulation steps per kernel launch\n"
+		<< "  --batch N              render N frames offline, no window\n"
+		<< "  --batch-first F        first frame of --batch\n"
+		<< "  --batch-depth K        --batch frames in flight\n"
+		<< "  --output-shm NAME      --batch frames to a shared-memory ring\n"
+		<< "  --validate             --batch compared with the CPU renderer\n"
+		<< "  --surfaces N           shared surfaces tiled in the window\n"
+		<< "  --frame-stats          luma min/average/max in the title\n"
+		<< "  --bench FILE           per-frame stage timings as CSV\n"
+		<< "  --bench-frames N       quit after N presented frames\n"
+		<< "  --soak N               stress the frame handoff, no CL or GL\n"
+		<< "  --soak-seed S          replay the faults of a --soak run\n";
+}
+
+bool parse_options(int argc, char* argv[], Options& opts) {
+	for (int i = 1; i < argc; ++i) {
+		const char* arg = argv[i];
+		if (!strcmp(arg, "--fullscreen-triangle")) {
+			opts.fullscreenTriangle = true;
+		} else if (!strcmp(arg, "--time-draws")) {
+			opts.timeDraws = true;
+		} else if (!strcmp(arg, "--capture") && i + 1 < argc) {
+			opts.capturePath = argv[++i];
+		} else if (!strcmp(arg, "--capture-depth") && i + 1 < argc) {
+			opts.captureDepth = atoi(argv[++i]);
+			if (opts.captureDepth < 1) {
+				cerr << "--capture-depth must be at least 1" << endl;
+				return false;
+			}
+		} else if (!strcmp(arg, "--input") && i + 1 < argc) {
+			opts.inputPath = argv[++i];
+		} else if (!strcmp(arg, "--input-fps") && i + 1 < argc) {
+			opts.inputFps = atof(argv[++i]);
+			if (opts.inputFps <= 0) {
+				cerr << "--input-fps must be positive" << endl;
+				return false;
+			}
+		} else if (!strcmp(arg, "--input-shm") && i + 1 < argc) {
+			opts.inputShm = argv[++i];
+		} else if (!strcmp(arg, "--low-latency")) {
+			opts.lowLatency = true;
+		} else if (!strcmp(arg, "--steps-per-frame") && i + 1 < argc) {
+			opts.stepsPerFrame = atoi(argv[++i]);
+			if (opts.stepsPerFrame < 1) {
+				cerr << "--steps-per-frame must be at least 1" << endl;
+				return false;
+			}
+		} else if (!strcmp(arg, "--batch") && i + 1 < argc) {
+			opts.batchFrames = strtoull(argv[++i], NULL, 10);
+		} else if (!strcmp(arg, "--batch-first") && i + 1 < argc) {
+			opts.batchFirst = strtoull(argv[++i], NULL, 10);
+		} else if (!strcmp(arg, "--batch-depth") && i + 1 < argc) {
+			opts.batchDepth = atoi(argv[++i]);
+			if (opts.batchDepth < 1) {
+				cerr << "--batch-depth must be at least 1" << endl;
+				return false;
+			}
+		} else if (!strcmp(arg, "--output-shm") && i + 1 < argc) {
+			opts.outputShm = argv[++i];
+		} else if (!strcmp(arg, "--validate")) {
+			opts.validate = true;
+		} else if (!strcmp(arg, "--frame-stats")) {
+			opts.frameStats = true;
+		} else if (!strcmp(arg, "--bench") && i + 1 < argc) {
+			opts.benchPath = argv[++i];
+		} else if (!strcmp(arg, "--bench-frames") && i + 1 < argc) {
+			opts.benchFrames = strtoull(argv[++i], NULL, 10);
+		} else if (!strcmp(arg, "--soak") && i + 1 < argc) {
+			opts.soakFrames = strtoull(argv[++i], NULL, 10);
+		} else if (!strcmp(arg, "--soak-seed") && i + 1 < argc) {
+			opts.soakSeed = strtoll(argv[++i], NULL, 10);
+			if (opts.soakSeed < 0 || opts.soakSeed > UINT32_MAX) {
+				cerr << "--soak-seed must be in [0, 2^32)" << endl;
+				return false;
+			}
+		} else if (!strcmp(arg, "--surfaces") && i + 1 < argc) {
+			opts.surfaces = atoi(argv[++i]);
+			if (opts.surfaces < 1) {
+				cerr << "--surfaces must be at least 1" << endl;
+				return false;
+			}
+		} else {
+			cerr << "Unknown option: " << arg << endl;
+			usage(argv[0]);
+			return false;
+		}
+	}
+	if (opts.validate && opts.batchFrames == 0) {
+		opts.batchFrames = 60;
+	}
+	// a batch renders its own frame range, it has no live input
+	if (opts.batchFrames > 0
+			&& (!opts.inputPath.empty() || !opts.inputShm.empty())) {
+		cerr << "--batch and --validate take no --input or --input-shm"
+			<< endl;
+		return false;
+	}
+	return true;
+}
+
+const char* kernel_name(const Options& opts) {
+	return opts.stepsPerFrame > 1 ? "glk_steps" : "glk";
+}
@@ -0,0 +1,60 @@
+#ifndef OPTIONS_HPP
+#define OPTIONS_HPP
+
+#include <cstdint>
+#include <string>
+
+/*
+ * Command line switches shared by both front-ends.
+ */
+struct Options {
+	// present with one generated triangle instead of the 4-vertex strip
+	bool fullscreenTriangle = false;
+	// time every draw with GL_TIME_ELAPSED and show it in the title
+	bool timeDraws = false;
+	// stream every presented frame to this file (.y4m or raw RGBA8)
+	std::string capturePath;
+	// pinned readback buffers, frames are dropped when all are busy
+	int captureDepth = 4;
+	// external RGBA8 frames for the kernel: a raw file played back at
+	// inputFps, or a shared-memory ring (see ShmRingHeader)
+	std::string inputPath;
+	double inputFps = 60;
+	std::string inputShm;
+	// latch parameters and input just before the kernel, one frame in
+	// flight, paced by presents instead of a fixed frame time
+	bool lowLatency = false;
+	// simulation steps per kernel launch (glk_steps), only the last one
+	// is presented
+	int stepsPerFrame = 1;
+	// offline: render frames [batchFirst, batchFirst + batchFrames)
+	// without a window, batchDepth of them in flight, to capturePath or
+	// the outputShm ring; 0 frames is the interactive mode
+	uint64_t batchFrames = 0;
+	uint64_t batchFirst = 0;
+	int batchDepth = 3;
+	std::string outputShm;
+	// batch mode checking every frame against the CPU renderer
+	bool validate = false;
+	// luma statistics of every frame on the device, see FrameStats
+	bool frameStats = false;
+	// per-frame stage timings to this CSV file at exit, see bench.hpp
+	std::string benchPath;
+	// quit after this many presented frames
+	uint64_t benchFrames = 0;
+	// frames through the thread handoff alone, see soak.hpp
+	uint64_t soakFrames = 0;
+	// replays the faults of an earlier --soak run, -1 picks a new seed
+	int64_t soakSeed = -1;
+	// shared textures, each with its own kernel instance, tiled in the
+	// window; captures show the first one
+	int surfaces = 1;
+};
+
+// false (after printing usage) on an unknown or malformed argument
+bool parse_options(int argc, char* argv[], Options& opts);
+
+// the kernel of gl_kernel.cl the options select
+const char* kernel_name(const Options& opts);
+
+#endif
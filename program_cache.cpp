@@ -0,0 +1,321 @@
+#include "program_cache.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sys/stat.h>
+
+using namespace std;
+
+// FNV-1a, stable across runs and builds unlike std::hash
+static uint64_t fnv1a(const string& s, uint64_t h = 14695981039346656037ull) {
+	for (unsigned char c : s) {
+		h ^= c;
+		h *= 1099511628211ull;
+	}
+	return h;
+}
+
+static string hex_key(const char* prefix, uint64_t h) {
+	char buf[32];
+	snprintf(buf, sizeof(buf), "%s-%016llx", prefix, (unsigned long long)h);
+	return buf;
+}
+
+static bool make_dir(const string& dir) {
+	return mkdir(dir.c_str(), 0755) == 0 || errno == EEXIST;
+}
+
+static bool read_file(const string& path, vector<char>& data) {
+	ifstream in(path, ios::binary);
+	if (!in) {
+		return false;
+	}
+	data.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+	return !data.empty();
+}
+
+// write to a temporary and rename, readers never see a partial entry
+static void write_file(const string& path, const char* data, size_t size) {
+	string tmp = path + ".tmp";
+	{
+		ofstream out(tmp, ios::binary | ios::trunc);
+		if (!out.write(data, size)) {
+			return;
+		}
+	}
+	rename(tmp.c_str(), path.c_str());
+}
+
+ProgramCache::ProgramCache() {
+	string dir;
+	if (const char* env = getenv("OGLCL_CACHE_DIR")) {
+		dir = env;
+	} else if (const char* xdg = getenv("XDG_CACHE_HOME")) {
+		dir = string(xdg) + "/oglcl";
+	} else if (const char* home = getenv("HOME")) {
+		make_dir(string(home) + "/.cache");
+		dir = string(home) + "/.cache/oglcl";
+	}
+	if (!dir.empty() && make_dir(dir)) {
+		dir_ = dir;
+	}
+}
+
+string ProgramCache::path(const string& key) const {
+	return dir_ + "/" + key;
+}
+
+string ProgramCache::keyGL(const vector<string>& sources) const {
+	uint64_t h = fnv1a("gl");
+	for (const string& s : sources) {
+		h = fnv1a(s, h);
+	}
+	h = fnv1a((const char*)glGetString(GL_VENDOR), h);
+	h = fnv1a((const char*)glGetString(GL_RENDERER), h);
+	h = fnv1a((const char*)glGetString(GL_VERSION), h);
+	return hex_key("gl", h);
+}
+
+bool ProgramCache::glBinaries() const {
+	if (glBinaries_ < 0) {
+		GLint formats = 0;
+		bool entryPoints = GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary;
+		if (entryPoints) {
+			glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+		}
+		glBinaries_ = entryPoints && formats > 0;
+	}
+	return glBinaries_ != 0;
+}
+
+GLuint ProgramCache::loadGL(const string& key) const {
+	vector<char> data;
+	if (!enabled() || !glBinaries() || !read_file(path(key), data)
+			|| data.size() <= sizeof(GLenum)) {
+		return 0;
+	}
+
+	GLenum format = *reinterpret_cast<const GLenum*>(data.data());
+	GLuint program = glCreateProgram();
+	glProgramBinary(program, format, data.data() + sizeof(GLenum),
+			data.size() - sizeof(GLenum));
+
+	// the driver may reject binaries from another build of itself
+	GLint status;
+	glGetProgramiv(program, GL_LINK_STATUS, &status);
+	if (status == GL_FALSE) {
+		glDeleteProgram(program);
+		return 0;
+	}
+	return program;
+}
+
+void ProgramCache::storeGL(const string& key, GLuint program) const {
+	if (!enabled() || !glBinaries()) {
+		return;
+	}
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0) {
+		return;
+	}
+
+	vector<char> data(sizeof(GLenum) + length);
+	GLenum format;
+	glGetProgramBinary(program, length, NULL, &format,
+			data.data() + sizeof(GLenum));
+	*reinterpret_cast<GLenum*>(data.data()) = format;
+	write_file(path(key), data.data(), data.size());
+}
+
+string ProgramCache::keyCL(const string& source,
+		const cl::Device& device) const {
+	string name, driver, version;
+	device.getInfo(CL_DEVICE_NAME, &name);
+	device.getInfo(CL_DRIVER_VERSION, &driver);
+	device.getInfo(CL_DEVICE_VERSION, &version);
+	uint64_t h = fnv1a("cl");
+	h = fnv1a(source, h);
+	h = fnv1a(name, h);
+	h = fnv1a(driver, h);
+	h = fnv1a(version, h);
+	return hex_key("cl", h);
+}
+
+bool ProgramCache::loadCL(const string& key, vector<char>& binary) const {
+	return enabled() && read_file(path(key), binary);
+}
+
+void ProgramCache::storeCL(const string& key,
+		const cl::Program& program) const {
+	if (!enabled()) {
+		return;
+	}
+	// built for a single device, so a single binary
+	size_t size = 0;
+	if (clGetProgramInfo(program(), CL_PROGRAM_BINARY_SIZES,
+				sizeof(size), &size, NULL) != CL_SUCCESS || size == 0) {
+		return;
+	}
+	vector<char> binary(size);
+	char* ptr = binary.data();
+	if (clGetProgramInfo(program(), CL_PROGRAM_BINARIES,
+				sizeof(ptr), &ptr, NULL) != CL_SUCCESS) {
+		return;
+	}
+	write_file(path(key), binary.data(), binary.size());
+}
+
+static void print_shader_log(GLuint shader, GLenum type) {
+	GLint infoLogLength;
+	glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &infoLogLength);
+	string log(infoLogLength + 1, '\0');
+	glGetShaderInfoLog(shader, infoLogLength, NULL, &log[0]);
+	fprintf(stderr, "Compile failure in %s shader:\n%s\n",
+			type == GL_VERTEX_SHADER ? "vertex" : "fragment",
+			log.c_str());
+}
+
+static void print_program_log(GLuint program) {
+	GLint infoLogLength;
+	glGetProgramiv(program, GL_INFO_LOG_LENGTH, &infoLogLength);
+	string log(infoLogLength + 1, '\0');
+	glGetProgramInfoLog(program, infoLogLength, NULL, &log[0]);
+	fprintf(stderr, "Linker failure: %s\n", log.c_str());
+}
+
+static void enable_parallel_compile() {
+#ifdef GL_KHR_parallel_shader_compile
+	if (GLEW_KHR_parallel_shader_compile) {
+		// 0xFFFFFFFF lets the driver pick the number of threads
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+		return;
+	}
+#endif
+#ifdef GL_ARB_parallel_shader_compile
+	if (GLEW_ARB_parallel_shader_compile) {
+		glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+	}
+#endif
+}
+
+vector<GLuint> BuildPrograms(const vector<ProgramSource>& sources,
+		const ProgramCache& cache) {
+	vector<GLuint> programs(sources.size(), 0);
+	vector<string> keys(sources.size());
+
+	for (size_t i = 0; i < sources.size(); ++i) {
+		keys[i] = cache.keyGL({sources[i].vertex, sources[i].fragment});
+		programs[i] = cache.loadGL(keys[i]);
+	}
+
+	enable_parallel_compile();
+
+	// kick off every compile and link before asking for any status,
+	// asking blocks until that one is done
+	struct Pending {
+		size_t idx;
+		GLuint vs, fs;
+	};
+	vector<Pending> pending;
+	for (size_t i = 0; i < sources.size(); ++i) {
+		if (programs[i]) {
+			continue;
+		}
+		Pending p;
+		p.idx = i;
+		p.vs = glCreateShader(GL_VERTEX_SHADER);
+		p.fs = glCreateShader(GL_FRAGMENT_SHADER);
+		const char* vsrc = sources[i].vertex.c_str();
+		const char* fsrc = sources[i].fragment.c_str();
+		glShaderSource(p.vs, 1, &vsrc, NULL);
+		glShaderSource(p.fs, 1, &fsrc, NULL);
+		glCompileShader(p.vs);
+		glCompileShader(p.fs);
+		pending.push_back(p);
+	}
+	for (const Pending& p : pending) {
+		GLuint program = glCreateProgram();
+		if (cache.enabled() && cache.glBinaries()) {
+			glProgramParameteri(program,
+					GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		}
+		glAttachShader(program, p.vs);
+		glAttachShader(program, p.fs);
+		glLinkProgram(program);
+		programs[p.idx] = program;
+	}
+
+	for (const Pending& p : pending) {
+		GLuint& program = programs[p.idx];
+		GLint status;
+		glGetProgramiv(program, GL_LINK_STATUS, &status);
+		if (status == GL_FALSE) {
+			GLint compiled;
+			glGetShaderiv(p.vs, GL_COMPILE_STATUS, &compiled);
+			if (compiled == GL_FALSE) {
+				print_shader_log(p.vs, GL_VERTEX_SHADER);
+			}
+			glGetShaderiv(p.fs, GL_COMPILE_STATUS, &compiled);
+			if (compiled == GL_FALSE) {
+				print_shader_log(p.fs, GL_FRAGMENT_SHADER);
+			}
+			print_program_log(program);
+			glDeleteProgram(program);
+			program = 0;
+		} else {
+			glDetachShader(program, p.vs);
+			glDetachShader(program, p.fs);
+			cache.storeGL(keys[p.idx], program);
+		}
+		glDeleteShader(p.vs);
+		glDeleteShader(p.fs);
+	}
+
+	return programs;
+}
+
+cl::Program BuildClProgram(const cl::Context& context,
+		const vector<cl::Device>& devices, const string& source,
+		const ProgramCache& cache, const string& options) {
+	string key = cache.keyCL(options + source, devices[0]);
+
+	vector<char> binary;
+	if (cache.loadCL(key, binary)) {
+		try {
+			cl::Program::Binaries binaries(1,
+					make_pair((const void*)binary.data(), binary.size()));
+			vector<cl_int> status;
+			cl::Program program(context, {devices[0]}, binaries, &status);
+			program.build({devices[0]}, options.c_str());
+			return program;
+		} catch (cl::Error error) {
+			// stale or foreign binary, rebuild it below
+			cerr << "Cached kernel rejected (" << error.err()
+				<< "), rebuilding" << endl;
+		}
+	}
+
+	// Creating the sources
+	cl::Program::Sources sources(1, make_pair(source.c_str(),
+				source.length()+1));
+	// Make program from sources
+	cl::Program program(context, sources);
+
+	// Compile sources
+	try {
+		program.build(devices, options.c_str());
+	} catch (cl::Error error) {
+		string log;
+		program.getBuildInfo(devices[0], CL_PROGRAM_BUILD_LOG, &log);
+		cerr << log << endl;
+		throw;
+	}
+	cache.storeCL(key, program);
+	return program;
+}
@@ -0,0 +1,74 @@
+#ifndef PROGRAM_CACHE_HPP
+#define PROGRAM_CACHE_HPP
+
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+#define __CL_ENABLE_EXCEPTIONS
+#include "CL/cl.hpp"
+
+/*
+ * On-disk cache of compiled GL programs and OpenCL program binaries,
+ * so later starts skip the compilers.
+ *
+ * Entries live in $OGLCL_CACHE_DIR, else $XDG_CACHE_HOME/oglcl, else
+ * ~/.cache/oglcl. Keys hash the sources together with the renderer or
+ * device and driver version, so a driver update just misses. Any read
+ * or load failure falls back to compiling from source.
+ */
+class ProgramCache {
+public:
+	ProgramCache();
+
+	bool enabled() const { return !dir_.empty(); }
+
+	/*
+	 * GL program binaries, need a current context: GL 4.1 or
+	 * ARB_get_program_binary with at least one binary format. Without
+	 * them loadGL() misses and storeGL() does nothing; checked once.
+	 */
+	bool glBinaries() const;
+	GLuint loadGL(const std::string& key) const;
+	void storeGL(const std::string& key, GLuint program) const;
+	std::string keyGL(const std::vector<std::string>& sources) const;
+
+	// OpenCL program binaries, for a single device
+	bool loadCL(const std::string& key, std::vector<char>& binary) const;
+	void storeCL(const std::string& key, const cl::Program& program) const;
+	std::string keyCL(const std::string& source,
+			const cl::Device& device) const;
+
+private:
+	std::string path(const std::string& key) const;
+
+	std::string dir_;
+	// -1 until glBinaries() first asked the context
+	mutable int glBinaries_ = -1;
+};
+
+struct ProgramSource {
+	std::string vertex;
+	std::string fragment;
+};
+
+/*
+ * Builds several GL programs, taking each from the cache when possible.
+ * The misses are compiled and linked before any status is queried so
+ * the driver can work on them in parallel (GL_KHR_parallel_shader_compile
+ * or the ARB variant). Failed programs come back as 0.
+ */
+std::vector<GLuint> BuildPrograms(const std::vector<ProgramSource>& sources,
+		const ProgramCache& cache);
+
+/*
+ * Creates and builds the OpenCL program for devices[0] from its cached
+ * binary, or from source (storing the binary) on a miss. options are
+ * the build options, part of the cache key.
+ */
+cl::Program BuildClProgram(const cl::Context& context,
+		const std::vector<cl::Device>& devices,
+		const std::string& source, const ProgramCache& cache,
+		const std::string& options = std::string());
+
+#endif
@@ -0,0 +1,688 @@
+#include "render_loop.hpp"
+
+#include <cstdio>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <memory>
+#include <atomic>
+
+#include "cl_arena.hpp"
+#include "async_log.hpp"
+#include "bench.hpp"
+#include "cl_setup.hpp"
+#include "cpu_render.hpp"
+#include "frame_capture.hpp"
+#include "frame_channel.hpp"
+#include "frame_stats.hpp"
+#include "gl_present.hpp"
+#include "input_source.hpp"
+#include "interop.hpp"
+#include "latency.hpp"
+#include "render_scale.hpp"
+#include "task_scheduler.hpp"
+
+using namespace std;
+
+static auto DREAM_FRAME_TIME = std::chrono::microseconds(16666);
+static auto BAD_FRAME_TIME = std::chrono::milliseconds(1666);
+// kernel budget inside DREAM_FRAME_TIME before the render scale drops
+static auto KERNEL_TIME_TARGET = std::chrono::microseconds(12000);
+
+// frames from the manager to the render thread, and the quit flag
+static FrameChannel frameChannel;
+// newest --frame-stats result from the manager, for the title
+static mutex statsMutex;
+static FrameStatsResult latestStats;
+// set by the R key, the manager rebuilds gl_kernel.cl between frames
+static atomic<bool> reloadKernel{false};
+
+// read from the window on the main thread, the render thread handles them
+static EventQueue events;
+// the window title can only be set from the main thread
+static mutex titleMutex;
+static string pendingTitle;
+
+static void manager(InteropContext& interop, const ProgramCache& cache,
+		FrameCapture* capture, InputStream* input, FrameStats* stats,
+		const Options& opts) {
+	cl::CommandQueue& queue = interop.queue();
+	const size_t surfaces = interop.textureCount();
+	const bool lowLatency = opts.lowLatency;
+	const int steps = opts.stepsPerFrame;
+	// every surface's image, acquired and released in one call
+	vector<cl::Memory> shared;
+	for (size_t i = 0; i < surfaces; ++i) {
+		const vector<cl::Memory>& objs = interop.texture(i).objects();
+		shared.insert(shared.end(), objs.begin(), objs.end());
+	}
+	// glk_steps keeps its per-pixel state across launches
+	vector<cl::Buffer> states;
+	if (steps > 1) {
+		size_t size = size_t(WINDOW_WIDTH) * WINDOW_HEIGHT * sizeof(cl_float4);
+		for (size_t i = 0; i < surfaces; ++i) {
+			states.push_back(interop.arena().buffer(size,
+						CL_MEM_READ_WRITE));
+			queue.enqueueFillBuffer(states.back(), 0.f, 0, size);
+		}
+	}
+	double lastSeconds = 0;
+	const int localSize = 2;
+	RenderScaleController scaler(KERNEL_TIME_TARGET, BAD_FRAME_TIME);
+	LatchScheduler latch;
+	cl::Event lastKernel;
+	uint64_t frame = 0;
+	while (!frameChannel.closed()) {
+		auto frameStart = chrono::steady_clock::now();
+		if (lowLatency) {
+			// one frame in flight: the previous one is presented first
+			if (!frameChannel.waitPresented()) {
+				break;
+			}
+			latch.presented(frameChannel.lastPresent());
+		}
+		// captured frames keep full resolution, a file has a fixed size
+		float scale = capture ? 1.f : scaler.scale();
+		int w = scaled_extent(WINDOW_WIDTH, scale, localSize);
+		int h = scaled_extent(WINDOW_HEIGHT, scale, localSize);
+
+		// hand back whatever last frame's commands are done with
+		interop.arena().collect();
+
+		if (stats) {
+			FrameStatsResult result;
+			if (stats->latest(result)) {
+				lock_guard<mutex> lk(statsMutex);
+				latestStats = result;
+			}
+		}
+
+		if (reloadKernel.exchange(false)) {
+			try {
+				cl::Program program = BuildClProgram(interop.context(),
+						interop.devices(), ReadSource("gl_kernel.cl"), cache);
+				interop.setProgram(program, kernel_name(opts));
+				cout << "Kernel reloaded" << endl;
+			} catch (cl::Error error) {
+				// keep running the previous kernel
+				cerr << "Kernel reload failed: " << error.what()
+					<< error.err() << endl;
+			} catch (runtime_error& error) {
+				cerr << error.what() << endl;
+			}
+			// on its own: it neither holds up nor breaks the main kernel
+			if (stats) {
+				try {
+					stats->reload(cache);
+				} catch (cl::Error error) {
+					cerr << "Frame stats reload failed: " << error.what()
+						<< error.err() << endl;
+				} catch (runtime_error& error) {
+					cerr << error.what() << endl;
+				}
+			}
+		}
+
+		if (lowLatency) {
+			std::this_thread::sleep_until(latch.latchAt());
+		}
+
+		// everything the frame shows is sampled from here on
+		auto latched = chrono::steady_clock::now();
+		if (lowLatency && input && lastKernel()) {
+			// the newest input, instead of the one staged last frame
+			input->advance(lastKernel);
+		}
+		uint64_t inputNs = input ? input->currentFrame().timestampNs : 0;
+		double seconds = chrono::duration<double>(
+				latched.time_since_epoch()).count();
+		float x = float(fmod(seconds * 0.6, 1.0));
+		// the steps cover the time since the previous latch, so x
+		// starts there and reaches this latch's value on the last one
+		float dx = 0;
+		if (steps > 1 && lastSeconds > 0) {
+			x = float(fmod(lastSeconds * 0.6, 1.0));
+			dx = float((seconds - lastSeconds) * 0.6 / steps);
+		}
+		lastSeconds = seconds;
+
+		// set every frame, a reloaded kernel starts without arguments
+		for (size_t i = 0; i < surfaces; ++i) {
+			cl::Kernel& gl_kernel = interop.kernel(i);
+			// the surfaces differ by the phase of the animation
+			float phase = float(i) / surfaces;
+			gl_kernel.setArg(0, interop.texture(i).image());
+			gl_kernel.setArg(1, x + phase > 1.f ? x + phase - 1.f : x + phase);
+			if (input) {
+				gl_kernel.setArg(2, input->current());
+				gl_kernel.setArg(3, WINDOW_WIDTH);
+				gl_kernel.setArg(4, WINDOW_HEIGHT);
+			} else {
+				// no external frames, the kernel draws its own
+				gl_kernel.setArg(2, sizeof(cl_mem), NULL);
+				gl_kernel.setArg(3, 0);
+				gl_kernel.setArg(4, 0);
+			}
+			if (steps > 1) {
+				gl_kernel.setArg(5, states[i]);
+				gl_kernel.setArg(6, dx);
+				gl_kernel.setArg(7, steps);
+			}
+		}
+
+		// in index order, as anyone else locking several of them must
+		vector<unique_lock<mutex> > texLocks;
+		for (size_t i = 0; i < surfaces; ++i) {
+			texLocks.emplace_back(interop.texture(i).lock());
+		}
+		// after GL's last draws from them, where the driver can tell
+		vector<cl::Event> drawn = interop.glDrawn();
+		queue.enqueueAcquireGLObjects(&shared,
+				drawn.empty() ? NULL : &drawn);
+
+		// Execute Kernel
+		cl::NDRange global(w, h);
+		cl::NDRange local(localSize, localSize);
+		vector<cl::Event> kernelsDone;
+		for (size_t i = 0; i < surfaces; ++i) {
+			cl::Event kernelDone;
+			try {
+				queue.enqueueNDRangeKernel(interop.kernel(i), cl::NullRange,
+						global, local,
+						input ? &input->currentReady() : NULL, &kernelDone);
+				kernelsDone.push_back(kernelDone);
+			} catch (cl::Error error) {
+				cerr << error.err() << endl;
+			}
+		}
+		bool launched = !kernelsDone.empty();
+
+		if (launched) {
+			// the queue is in order, the last launch covers the others
+			lastKernel = kernelsDone.back();
+		}
+		if (input && launched && !lowLatency) {
+			// uploads the next frame while these kernels run
+			input->advance(lastKernel);
+		}
+
+		if (stats && launched) {
+			// the first surface, at the size it was rendered
+			try {
+				stats->measure(queue, interop.texture(0).image(), w, h,
+						frame);
+			} catch (cl::Error error) {
+				cerr << "Frame stats: " << error.err() << endl;
+			}
+		}
+
+		if (capture && launched) {
+			capture->capture(queue, frame);
+		}
+		++frame;
+
+		cl::Event released;
+		queue.enqueueReleaseGLObjects(&shared, NULL, &released);
+		for (size_t i = 0; i < surfaces; ++i) {
+			interop.texture(i).clUsed(released);
+		}
+		texLocks.clear();
+
+		queue.finish();
+
+		// the render scale applies to all of them together
+		cl_ulong total = 0;
+		if (launched) {
+			for (cl::Event& e : kernelsDone) {
+				cl_ulong start, end;
+				e.getProfilingInfo(CL_PROFILING_COMMAND_START, &start);
+				e.getProfilingInfo(CL_PROFILING_COMMAND_END, &end);
+				total += end - start;
+			}
+			scaler.update(chrono::duration_cast<chrono::microseconds>(
+						chrono::nanoseconds(total)));
+		}
+		auto submitted = chrono::steady_clock::now();
+		latch.frameTook(chrono::duration_cast<chrono::microseconds>(
+					submitted - latched));
+
+		if (!lowLatency) {
+			std::this_thread::sleep_until(frameStart + DREAM_FRAME_TIME);
+		}
+		FrameInfo info;
+		info.width = w;
+		info.height = h;
+		info.launched = launched;
+		info.latched = latched;
+		info.inputNs = inputNs;
+		info.kernelMicros = total / 1000.0;
+		info.submitMicros = chrono::duration<double, micro>(
+				submitted - latched).count();
+		frameChannel.publish(info);
+	}
+	for (cl::Buffer& state : states) {
+		interop.arena().recycle(state, lastKernel);
+	}
+}
+
+int RunWindow(AppWindow& window, const Options& opts,
+		const vector<cl::Platform>& platforms,
+		future<string>& kernelSource, const ProgramCache& cache,
+		StartupTimer& startup) {
+	// owns every CL object, torn down before the GL context
+	unique_ptr<InteropContext> interop;
+	// without a usable OpenCL platform the frames come from the CPU
+	bool cpuFallback = platforms.empty();
+
+	const GLubyte* renderer = glGetString(GL_RENDERER);
+	const GLubyte* version = glGetString(GL_VERSION);
+	printf ("Renderer: %s\n", renderer);
+	printf ("OpenGL version supported %s\n", version);
+
+	// The interop context needs the GL context, everything else on the
+	// GL side only needs the GL context too; so the program build runs
+	// on a worker while GLEW, the shaders and the texture come up here.
+	future<cl::Program> programBuild;
+	if (!cpuFallback) {
+		try {
+			// Link OpenCL with OpenGL
+			cl_context_properties glContext, glDisplay;
+			window.glSharing(glContext, glDisplay);
+			cl_context_properties cl_properties[] = {
+				CL_GL_CONTEXT_KHR, glContext,
+				CL_GLX_DISPLAY_KHR, glDisplay,
+				CL_CONTEXT_PLATFORM,
+				(cl_context_properties)(platforms[0])(), 
+				0};
+
+			interop.reset(new InteropContext(platforms[0], cl_properties));
+			startup.mark("CL context");
+
+			programBuild = async(launch::async, [&]() {
+				cl::Program p = BuildClProgram(interop->context(),
+						interop->devices(), kernelSource.get(), cache);
+				startup.mark("CL program (worker)");
+				return p;
+			});
+		} catch (cl::Error error) {
+			cout << error.what() << error.err() << endl;
+			cpuFallback = true;
+		} catch (runtime_error& error) {
+			// no device shares this GL context
+			cerr << error.what() << endl;
+			cpuFallback = true;
+		}
+		if (cpuFallback) {
+			interop.reset();
+		}
+	}
+	if (cpuFallback) {
+		cerr << "No OpenCL interop, rendering on the CPU" << endl;
+	}
+	// Initialize GLEW
+	if (glewInit() != GLEW_OK) {
+		cout << "Failed to initialize GLEW" << endl;
+		return 1;
+	}
+
+	auto lastTime = chrono::steady_clock::now();
+	int frames = 0;
+
+	int width, height;
+	window.framebufferSize(width, height);
+
+	glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+
+	glViewport(0, 0, width, height);
+
+	unique_ptr<Presenter> presenter(new Presenter(opts.fullscreenTriangle ?
+			QuadMode::FullscreenTriangle : QuadMode::TriangleStrip,
+			opts.timeDraws, opts.surfaces, cache));
+	startup.mark("GL program");
+
+	// host-side work of every frame, beside the render and manager threads
+	TaskScheduler tasks;
+
+	unique_ptr<CpuRenderer> cpu;
+	unique_ptr<PboTexture> cpuTexture;
+	if (cpuFallback) {
+		cpu.reset(new CpuRenderer(tasks, WINDOW_WIDTH, WINDOW_HEIGHT));
+		cpuTexture.reset(new PboTexture(WINDOW_WIDTH, WINDOW_HEIGHT));
+		startup.mark("GL texture");
+		if (!opts.inputPath.empty() || !opts.inputShm.empty()
+				|| !opts.capturePath.empty() || opts.surfaces > 1
+				|| opts.stepsPerFrame > 1 || opts.frameStats) {
+			cerr << "Input, capture, surfaces, steps and frame stats need "
+				"OpenCL, ignored" << endl;
+		}
+	} else {
+		try {
+			for (int i = 0; i < opts.surfaces; ++i) {
+				interop->addTexture(WINDOW_WIDTH, WINDOW_HEIGHT);
+			}
+			startup.mark("GL texture");
+			// Make kernel
+			interop->setProgram(programBuild.get(), kernel_name(opts));
+		} catch(cl::Error error) {
+			cout << error.what()  << error.err() << endl;
+			throw error;
+		}
+	}
+
+	unique_ptr<InputStream> input;
+	if (interop) {
+		try {
+			unique_ptr<InputSource> source;
+			if (!opts.inputPath.empty()) {
+				source.reset(new MappedFileSource(opts.inputPath,
+							WINDOW_WIDTH, WINDOW_HEIGHT, opts.inputFps));
+			} else if (!opts.inputShm.empty()) {
+				source.reset(new SharedMemorySource(opts.inputShm,
+							WINDOW_WIDTH, WINDOW_HEIGHT));
+			}
+			if (source) {
+				input.reset(new InputStream(interop->arena(),
+							interop->devices()[0],
+							move(source), WINDOW_WIDTH, WINDOW_HEIGHT));
+			}
+		} catch (runtime_error& error) {
+			cerr << error.what() << endl;
+			return 1;
+		}
+	}
+
+	unique_ptr<FrameCapture> capture;
+	if (interop && !opts.capturePath.empty()) {
+		capture.reset(new FrameCapture(tasks, interop->arena(),
+					interop->texture(0).image(),
+					opts.capturePath, WINDOW_WIDTH, WINDOW_HEIGHT, opts.captureDepth));
+	}
+
+	unique_ptr<FrameStats> stats;
+	if (interop && opts.frameStats) {
+		try {
+			stats.reset(new FrameStats(interop->arena(),
+						interop->devices()[0], cache));
+		} catch (cl::Error error) {
+			cerr << "Frame stats: " << error.what() << error.err() << endl;
+		} catch (runtime_error& error) {
+			cerr << "Frame stats: " << error.what() << endl;
+		}
+	}
+
+	unique_ptr<BenchRecorder> bench;
+	if (!opts.benchPath.empty()) {
+		bench.reset(new BenchRecorder(opts.benchPath));
+	}
+
+	// Start second thread, unless the render thread does it all
+	thread mgr;
+	if (interop) {
+		mgr = thread(manager, ref(*interop), cref(cache), capture.get(),
+				input.get(), stats.get(), cref(opts));
+	}
+
+	// latch to present, and input frame to present
+	LatencyStats latchLatency;
+	LatencyStats inputLatency;
+
+	// the main thread only waits for window events from here on, the
+	// render thread owns the GL context until it is done
+	AsyncLog eventLog(cout);
+	// the window is split into one tile per surface
+	const int surfaces = cpu ? 1 : opts.surfaces;
+	const int cols = int(ceil(sqrt(double(surfaces))));
+	const int rows = (surfaces + cols - 1) / cols;
+	int viewWidth = width;
+	int viewHeight = height;
+	future<void> diagnostics;
+	auto handleEvents = [&]() {
+		WindowEvent e;
+		while (events.pop(e)) {
+			if (e.type == WindowEvent::RESIZE) {
+				eventLog.line("Viewport: " + to_string(e.width) + ","
+						+ to_string(e.height));
+				viewWidth = e.width;
+				viewHeight = e.height;
+				continue;
+			}
+			eventLog.line("Key: " + to_string(e.code) + " ["
+					+ to_string(e.pressed) + "]");
+			if (e.key == WindowEvent::KEY_ESCAPE && e.pressed) {
+				frameChannel.close();
+			} else if (e.key == WindowEvent::KEY_R && e.pressed) {
+				reloadKernel = true;
+			}
+		}
+	};
+
+	window.makeCurrent(false);
+	thread render([&]() {
+		window.makeCurrent(true);
+		chrono::steady_clock::time_point previousPresent;
+		while (!frameChannel.closed()) {
+			if (cpu) {
+				// no manager, the frame is rendered right here
+				auto latched = chrono::steady_clock::now();
+				double seconds = chrono::duration<double>(
+						latched.time_since_epoch()).count();
+				float x = float(fmod(seconds * 0.6, 1.0));
+				cpuTexture->update([&](unsigned char* rgba, size_t stride) {
+					cpu->render(rgba, stride, x, NULL, 0, 0);
+				});
+				FrameInfo info;
+				info.width = WINDOW_WIDTH;
+				info.height = WINDOW_HEIGHT;
+				info.latched = latched;
+				// the renderer and the upload, there is nothing else
+				info.kernelMicros = chrono::duration<double, micro>(
+						chrono::steady_clock::now() - latched).count();
+				info.submitMicros = info.kernelMicros;
+				frameChannel.publish(info);
+			}
+			// not locked while drawing: the manager only waits for
+			// presented(). It may write the textures again meanwhile, its
+			// acquire waits for drawn() where the driver supports it
+			FrameInfo frame;
+			FrameChannel::Result got = frameChannel.take(frame,
+					chrono::milliseconds(5));
+			if (got == FrameChannel::CLOSED) {
+				break;
+			}
+			if (got == FrameChannel::TIMEOUT) {
+				handleEvents();
+				continue;
+			}
+			auto taken = chrono::steady_clock::now();
+
+			presenter->setTexScale(float(frame.width) / WINDOW_WIDTH,
+					float(frame.height) / WINDOW_HEIGHT);
+			for (int i = 0; i < surfaces; ++i) {
+				int col = i % cols;
+				int row = i / cols;
+				glViewport(col * viewWidth / cols,
+						(rows - 1 - row) * viewHeight / rows,
+						viewWidth / cols, viewHeight / rows);
+				if (cpu) {
+					presenter->draw(cpuTexture->texture());
+					continue;
+				}
+				presenter->draw(interop->texture(i).texture());
+			}
+			if (!cpu) {
+				interop->drawn();
+			}
+
+			window.swapBuffers();
+			if (opts.lowLatency) {
+				// nor queued in the driver: wait for this present to finish
+				GLsync swapped = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+				glClientWaitSync(swapped, GL_SYNC_FLUSH_COMMANDS_BIT,
+						GL_TIMEOUT_IGNORED);
+				glDeleteSync(swapped);
+			}
+			auto presented = chrono::steady_clock::now();
+			latchLatency.add(chrono::duration_cast<chrono::microseconds>(
+						presented - frame.latched));
+			if (frame.inputNs) {
+				inputLatency.add(chrono::duration_cast<chrono::microseconds>(
+							presented.time_since_epoch()
+							- chrono::nanoseconds(frame.inputNs)));
+			}
+
+			frameChannel.presented(frame, presented);
+
+			// a failed launch has no kernel time to report
+			if (bench && frame.launched
+					&& previousPresent != chrono::steady_clock::time_point()) {
+				BenchSample sample;
+				sample.frame = frame.sequence;
+				sample.frameUs = chrono::duration<double, micro>(
+						presented - previousPresent).count();
+				sample.kernelUs = frame.kernelMicros;
+				sample.submitUs = frame.submitMicros;
+				sample.presentUs = chrono::duration<double, micro>(
+						presented - taken).count();
+				sample.latencyUs = chrono::duration<double, micro>(
+						presented - frame.latched).count();
+				bench->add(sample);
+			}
+			previousPresent = presented;
+			if (opts.benchFrames
+					&& frameChannel.presentedCount() >= opts.benchFrames) {
+				frameChannel.close();
+			}
+
+			handleEvents();
+
+			if (!diagnostics.valid()) {
+				startup.mark("first frame");
+				startup.report();
+				// the verbose listing would only have delayed the first frame
+				diagnostics = async(launch::async, [&]() {
+					PrintPlatforms(platforms);
+					cout << string(32, '-') << endl;
+					cout << "Interop OpenGL/OpenCL Devices" << endl;
+					if (interop) {
+						PrintDevices(interop->devices());
+					}
+					cout << string(32, '-') << endl;
+				});
+			}
+
+			++frames;
+			auto now = chrono::steady_clock::now();
+			if (now - lastTime >= chrono::seconds(3)) {
+				lastTime = now;
+				string title;
+				title = "oglcl - FPS: " + to_string(frames/3.0);
+				if (opts.timeDraws) {
+					title += " - draw: " + to_string(
+							presenter->takeAverageDrawMicros()) + " us";
+				}
+				if (opts.lowLatency) {
+					title += " - latency: " + to_string(
+							latchLatency.takeAverageMicros()) + " us";
+				}
+				if (stats) {
+					lock_guard<mutex> slk(statsMutex);
+					title += " - luma: " + to_string(latestStats.minLuma)
+						+ "/" + to_string(int(latestStats.averageLuma))
+						+ "/" + to_string(latestStats.maxLuma);
+				}
+				{
+					lock_guard<mutex> tlk(titleMutex);
+					pendingTitle = title;
+				}
+				window.wake();
+				frames = 0;
+			}
+		}
+		window.makeCurrent(false);
+		// wakes the main thread when the render thread saw the quit first
+		window.wake();
+	});
+
+	while (!frameChannel.closed()) {
+		if (!window.waitEvents(events)) {
+			frameChannel.close();
+		}
+		lock_guard<mutex> tlk(titleMutex);
+		if (!pendingTitle.empty()) {
+			window.setTitle(pendingTitle);
+			pendingTitle.clear();
+		}
+	}
+
+	frameChannel.close();
+	render.join();
+	if (mgr.joinable()) {
+		mgr.join();
+	}
+	window.makeCurrent(true);
+	if (diagnostics.valid()) {
+		diagnostics.wait();
+	}
+
+	if (opts.timeDraws) {
+		cout << "Draws ("
+			<< (opts.fullscreenTriangle ? "triangle" : "strip") << "): "
+			<< presenter->averageDrawMicros() << " us average over "
+			<< presenter->timedDraws() << " draws" << endl;
+	}
+
+	cout << "Latency (latch to present): " << latchLatency.averageMicros()
+		<< " us average, " << latchLatency.maxMicros() << " us max" << endl;
+	if (inputLatency.count()) {
+		cout << "Latency (input to present): "
+			<< inputLatency.averageMicros() << " us average, "
+			<< inputLatency.maxMicros() << " us max" << endl;
+	}
+
+	if (capture) {
+		capture->finish();
+		cout << "Capture: " << capture->written() << " frames written, "
+			<< capture->dropped() << " dropped" << endl;
+		capture.reset();
+	}
+
+	if (bench && bench->write()) {
+		cout << "Bench: " << bench->count() << " frames written to "
+			<< opts.benchPath << endl;
+	}
+
+	if (stats) {
+		cout << "Frame stats: " << stats->measured() << " measured, "
+			<< stats->skipped() << " skipped" << endl;
+		stats.reset();
+	}
+
+	if (input) {
+		cout << "Input: " << input->uploaded() << " frames uploaded ("
+			<< input->inPlace() << " read in place), "
+			<< input->dropped() << " dropped" << endl;
+		input.reset();
+	}
+
+	tasks.waitAll();
+	cout << "Tasks: " << tasks.executed() << " run, " << tasks.stolen()
+		<< " stolen, " << tasks.threads() << " workers" << endl;
+
+	if (interop) {
+		ArenaStats arenaStats = interop->arena().stats();
+		cout << "Arena: " << arenaStats.creates << " allocations, "
+			<< arenaStats.reuses << " reuses, high water "
+			<< arenaStats.highWater / 1024 << " KiB" << endl;
+	}
+	// waits for the shared texture only, CL goes before GL
+	interop.reset();
+
+	cpuTexture.reset();
+	presenter.reset();
+	return 0;
+}
@@ -0,0 +1,59 @@
+#ifndef RENDER_LOOP_HPP
+#define RENDER_LOOP_HPP
+
+#include <future>
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+#define __CL_ENABLE_EXCEPTIONS
+#include "CL/cl.hpp"
+
+#include "event_queue.hpp"
+#include "options.hpp"
+#include "program_cache.hpp"
+#include "startup.hpp"
+
+const int WINDOW_WIDTH = 640;
+const int WINDOW_HEIGHT = 480;
+
+/*
+ * A front-end's window, as RunWindow() uses it. It is created on the
+ * main thread with its GL context current; the render thread takes the
+ * context over with makeCurrent() while the main thread only waits for
+ * window events.
+ */
+class AppWindow {
+public:
+	virtual ~AppWindow() {}
+
+	// CL_GL_CONTEXT_KHR and CL_GLX_DISPLAY_KHR of the current context,
+	// runtime_error when it can't be shared
+	virtual void glSharing(cl_context_properties& context,
+			cl_context_properties& display) = 0;
+	virtual void framebufferSize(int& width, int& height) = 0;
+	// the GL context current on the calling thread, or released
+	virtual void makeCurrent(bool current) = 0;
+	virtual void swapBuffers() = 0;
+
+	// main thread: waits a while for window events and hands them to
+	// events, false once the window was closed
+	virtual bool waitEvents(EventQueue& events) = 0;
+	virtual void setTitle(const std::string& title) = 0;
+	// any thread: waitEvents() returns soon
+	virtual void wake() = 0;
+};
+
+/*
+ * Everything both front-ends do once the window exists: the interop
+ * context, or the CPU renderer without one; the manager thread
+ * rendering with OpenCL, the render thread presenting, the main thread
+ * waiting for window events; the statistics at exit. Returns the exit
+ * code once every GL object is gone, the context is current again.
+ */
+int RunWindow(AppWindow& window, const Options& opts,
+		const std::vector<cl::Platform>& platforms,
+		std::future<std::string>& kernelSource, const ProgramCache& cache,
+		StartupTimer& startup);
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef RENDER_SCALE_HPP
+#define RENDER_SCALE_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+/*
+ * Picks the fraction of the shared texture the kernel renders into,
+ * from the measured kernel time against a target.
+ *
+ * Pixel cost grows with scale^2, so the next scale is the current one
+ * times sqrt(target/measured), smoothed and rate limited to avoid
+ * oscillating around the target. A single frame slower than the
+ * emergency threshold drops straight to the minimum scale.
+ */
+class RenderScaleController {
+public:
+	RenderScaleController(std::chrono::microseconds target,
+			std::chrono::microseconds emergency,
+			float min_scale = 0.25f)
+		: target_(target), emergency_(emergency),
+		min_scale_(min_scale) {}
+
+	float update(std::chrono::microseconds kernel_time) {
+		if (kernel_time >= emergency_) {
+			scale_ = min_scale_;
+			avg_us_ = 0;
+			return scale_;
+		}
+
+		double t = static_cast<double>(kernel_time.count());
+		avg_us_ = avg_us_ <= 0 ? t : avg_us_ + 0.2 * (t - avg_us_);
+		if (avg_us_ <= 0) {
+			return scale_;
+		}
+
+		double ratio = target_.count() / avg_us_;
+		// deadband: don't chase noise around the target
+		if (ratio > 0.9 && ratio < 1.1) {
+			return scale_;
+		}
+
+		double wanted = scale_ * std::sqrt(ratio);
+		wanted = std::min(wanted, scale_ * 1.05);
+		wanted = std::max(wanted, scale_ * 0.8);
+		scale_ = std::min(1.f, std::max(min_scale_,
+					static_cast<float>(wanted)));
+		return scale_;
+	}
+
+	float scale() const { return scale_; }
+
+private:
+	std::chrono::microseconds target_;
+	std::chrono::microseconds emergency_;
+	float min_scale_;
+	float scale_ = 1.f;
+	double avg_us_ = 0;
+};
+
+/*
+ * Size of the scaled render rectangle, rounded down to a multiple of
+ * the work-group size so it stays a valid NDRange.
+ */
+inline int scaled_extent(int full, float scale, int local) {
+	int n = static_cast<int>(full * scale) / local * local;
+	return std::max(local, std::min(full, n));
+}
+
+#endif
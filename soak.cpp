@@ -0,0 +1,244 @@
+#include "soak.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <thread>
+
+#include "event_queue.hpp"
+#include "frame_channel.hpp"
+
+using namespace std;
+
+// one in N frames, for each fault
+const int KERNEL_FAILURE_RATE = 500;
+const int SLOW_KERNEL_RATE = 1000;
+const int SLOW_PRESENT_RATE = 1000;
+// one in N sessions quits while frames are still coming
+const int EARLY_QUIT_RATE = 4;
+const uint64_t MAX_SESSION_FRAMES = 50000;
+// no frame published or presented for this long is a hang
+const auto STALL_TIMEOUT = chrono::seconds(5);
+
+struct SoakTotals {
+	uint64_t sessions = 0;
+	uint64_t published = 0;
+	uint64_t presented = 0;
+	uint64_t replaced = 0;
+	uint64_t kernelFailures = 0;
+	uint64_t failedPresented = 0;
+	uint64_t slowPresents = 0;
+	uint64_t errors = 0;
+};
+
+static void sleep_up_to(mt19937& rng, int maxMicros) {
+	this_thread::sleep_for(chrono::microseconds(rng() % maxMicros));
+}
+
+// false on a protocol violation, already reported
+static bool soak_session(uint64_t frames, bool lowLatency, uint32_t seed,
+		SoakTotals& totals) {
+	FrameChannel channel;
+	EventQueue events;
+	atomic<uint64_t> progress{0};
+	atomic<int> finished{0};
+	atomic<bool> produced{false};
+	uint64_t kernelFailures = 0;
+	uint64_t slowPresents = 0;
+	uint64_t presented = 0;
+	uint64_t failedPresented = 0;
+	uint64_t errors = 0;
+
+	// the manager: frames until the count or the quit
+	thread manager([&]() {
+		mt19937 rng(seed);
+		for (uint64_t n = 0; n < frames && !channel.closed(); ++n) {
+			if (lowLatency && !channel.waitPresented()) {
+				break;
+			}
+			FrameInfo info;
+			info.latched = chrono::steady_clock::now();
+			// as in the manager: a failed launch runs nothing, and still
+			// hands over a frame, the old image
+			if (rng() % KERNEL_FAILURE_RATE == 0) {
+				++kernelFailures;
+				info.launched = false;
+			} else if (rng() % SLOW_KERNEL_RATE == 0) {
+				sleep_up_to(rng, 200);
+			}
+			channel.publish(info);
+			++progress;
+		}
+		produced = true;
+		++finished;
+	});
+
+	// the render thread: presents, handles the events, quits on escape
+	thread render([&]() {
+		mt19937 rng(seed + 1);
+		uint64_t last = 0;
+		auto handleEvents = [&]() {
+			WindowEvent e;
+			while (events.pop(e)) {
+				if (e.key == WindowEvent::KEY_ESCAPE && e.pressed) {
+					channel.close();
+				}
+			}
+		};
+		while (!channel.closed()) {
+			FrameInfo frame;
+			FrameChannel::Result got = channel.take(frame,
+					chrono::milliseconds(5));
+			if (got == FrameChannel::CLOSED) {
+				break;
+			}
+			if (got == FrameChannel::TIMEOUT) {
+				handleEvents();
+				continue;
+			}
+			if (frame.sequence <= last) {
+				cerr << "Soak: frame " << frame.sequence
+					<< " presented after " << last << endl;
+				++errors;
+			}
+			last = frame.sequence;
+			if (!frame.launched) {
+				++failedPresented;
+			}
+			if (rng() % SLOW_PRESENT_RATE == 0) {
+				++slowPresents;
+				sleep_up_to(rng, 2000);
+			}
+			channel.presented(frame, chrono::steady_clock::now());
+			++presented;
+			++progress;
+			handleEvents();
+		}
+		++finished;
+	});
+
+	// the main thread: escape once the frames are out, or earlier
+	thread window([&]() {
+		mt19937 rng(seed + 2);
+		bool early = rng() % EARLY_QUIT_RATE == 0;
+		uint64_t quitAt = frames ? rng() % frames : 0;
+		while (!channel.closed()) {
+			if (early ? progress >= quitAt
+					: produced && !channel.pending()) {
+				break;
+			}
+			this_thread::sleep_for(chrono::microseconds(100));
+		}
+		WindowEvent e;
+		e.type = WindowEvent::KEY;
+		e.key = WindowEvent::KEY_ESCAPE;
+		e.pressed = true;
+		if (rng() % 2 || !events.push(e)) {
+			// the window closed instead
+			channel.close();
+		}
+		++finished;
+	});
+
+	uint64_t seen = 0;
+	auto lastProgress = chrono::steady_clock::now();
+	while (finished < 3) {
+		this_thread::sleep_for(chrono::milliseconds(10));
+		auto now = chrono::steady_clock::now();
+		if (progress != seen) {
+			seen = progress;
+			lastProgress = now;
+		} else if (now - lastProgress > STALL_TIMEOUT) {
+			cerr << "Soak: hang in session " << totals.sessions
+				<< (lowLatency ? " (low latency)" : "") << ", "
+				<< finished << " of 3 threads done, frame "
+				<< channel.published() << endl;
+			abort();
+		}
+	}
+	manager.join();
+	render.join();
+	window.join();
+
+	uint64_t published = channel.published();
+	uint64_t replaced = channel.replaced();
+	uint64_t pending = channel.pending() ? 1 : 0;
+	if (presented != channel.presentedCount()) {
+		cerr << "Soak: " << presented << " presented, the channel counted "
+			<< channel.presentedCount() << endl;
+		++errors;
+	}
+	if (published != presented + replaced + pending) {
+		cerr << "Soak: " << published << " published, " << presented
+			<< " presented, " << replaced << " replaced, " << pending
+			<< " pending: frames lost" << endl;
+		++errors;
+	}
+	// failed frames go through the same accounting as the others
+	if (channel.failed() != kernelFailures
+			|| failedPresented > kernelFailures
+			|| (lowLatency && kernelFailures - failedPresented > pending)) {
+		cerr << "Soak: " << kernelFailures << " kernel failures, "
+			<< channel.failed() << " published, " << failedPresented
+			<< " presented" << endl;
+		++errors;
+	}
+	if (lowLatency && replaced) {
+		cerr << "Soak: " << replaced << " frames replaced in low latency"
+			<< endl;
+		++errors;
+	}
+
+	++totals.sessions;
+	totals.published += published;
+	totals.presented += presented;
+	totals.replaced += replaced;
+	totals.kernelFailures += kernelFailures;
+	totals.failedPresented += failedPresented;
+	totals.slowPresents += slowPresents;
+	totals.errors += errors;
+	return errors == 0;
+}
+
+int RunSoak(const Options& opts) {
+	uint32_t seed;
+	if (opts.soakSeed >= 0) {
+		seed = uint32_t(opts.soakSeed);
+	} else {
+		random_device rd;
+		seed = rd();
+	}
+	cout << "Soak: " << opts.soakFrames << " frames, seed " << seed
+		<< " (--soak-seed to replay)" << endl;
+	mt19937 rng(seed);
+
+	SoakTotals totals;
+	auto start = chrono::steady_clock::now();
+	while (totals.published < opts.soakFrames) {
+		uint64_t left = opts.soakFrames - totals.published;
+		// not drawn from what is left: an early quit would change every
+		// later session of a replay
+		uint64_t frames = min(left, 1 + rng() % MAX_SESSION_FRAMES);
+		bool lowLatency = totals.sessions % 2 == 1;
+		soak_session(frames, lowLatency, rng(), totals);
+	}
+	double seconds = chrono::duration<double>(
+			chrono::steady_clock::now() - start).count();
+
+	cout << "Soak: " << totals.sessions << " sessions, "
+		<< totals.published << " frames published, " << totals.presented
+		<< " presented, " << totals.replaced << " replaced" << endl;
+	cout << "Soak: " << totals.kernelFailures << " kernel failures ("
+		<< totals.failedPresented << " presented), "
+		<< totals.slowPresents << " slow presents injected" << endl;
+	cout << "Soak: " << seconds << " s, " << totals.presented / seconds
+		<< " frames/s presented" << endl;
+	if (totals.errors) {
+		cout << "Soak: FAIL, " << totals.errors << " errors" << endl;
+		return 1;
+	}
+	cout << "Soak: PASS" << endl;
+	return 0;
+}
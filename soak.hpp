@@ -0,0 +1,23 @@
+#ifndef SOAK_HPP
+#define SOAK_HPP
+
+#include "options.hpp"
+
+/*
+ * --soak N: the frame handoff of the front-ends without CL or GL, for N
+ * published frames. A manager, render and event thread run the same
+ * FrameChannel and EventQueue protocol as the window, in short sessions
+ * alternating the normal and the low-latency mode, with random delays,
+ * failed kernel launches, slow presents and a quit at random points.
+ *
+ * Every session checks that no frame was presented twice or out of
+ * order and that every published frame was presented, replaced, or was
+ * pending at the quit, failed launches included; a session that stops
+ * making progress counts as a hang and aborts. --soak-seed replays the
+ * faults and session lengths of a run; the thread interleaving
+ * differs. Prints the throughput, returns the exit code. Build with
+ * -DOGLCL_TSAN=ON to run it under ThreadSanitizer.
+ */
+int RunSoak(const Options& opts);
+
+#endif
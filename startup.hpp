@@ -0,0 +1,39 @@
+#ifndef STARTUP_HPP
+#define STARTUP_HPP
+
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*
+ * Timeline of the startup stages, relative to construction. Stages are
+ * marked from whichever thread finished them.
+ */
+class StartupTimer {
+public:
+	StartupTimer() : start_(std::chrono::steady_clock::now()) {}
+
+	void mark(const std::string& stage) {
+		auto t = std::chrono::steady_clock::now() - start_;
+		std::lock_guard<std::mutex> lk(m_);
+		stages_.emplace_back(stage,
+				std::chrono::duration<double, std::milli>(t).count());
+	}
+
+	void report() const {
+		std::lock_guard<std::mutex> lk(m_);
+		std::cout << "Startup:" << std::endl;
+		for (const auto& s : stages_) {
+			std::cout << "  " << s.second << " ms\t" << s.first << std::endl;
+		}
+	}
+
+private:
+	std::chrono::steady_clock::time_point start_;
+	mutable std::mutex m_;
+	std::vector<std::pair<std::string, double> > stages_;
+};
+
+#endif
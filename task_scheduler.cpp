@@ -0,0 +1,195 @@
+#include "task_scheduler.hpp"
+
+#include <iostream>
+
+using namespace std;
+
+// index of the worker running on this thread, -1 elsewhere
+static thread_local int currentWorker = -1;
+static thread_local const TaskScheduler* currentScheduler = nullptr;
+
+TaskScheduler::TaskScheduler(unsigned threads) {
+	if (threads == 0) {
+		unsigned hw = thread::hardware_concurrency();
+		threads = hw > 3 ? hw - 2 : 1;
+	}
+	for (unsigned i = 0; i < threads; ++i) {
+		workers_.emplace_back(new Worker);
+	}
+	// started once all deques exist, workers steal from each other
+	for (size_t i = 0; i < workers_.size(); ++i) {
+		workers_[i]->thread = thread(&TaskScheduler::worker, this, i);
+	}
+}
+
+TaskScheduler::~TaskScheduler() {
+	waitAll();
+	{
+		lock_guard<mutex> lk(m_);
+		stop_ = true;
+	}
+	work_.notify_all();
+	for (auto& w : workers_) {
+		w->thread.join();
+	}
+}
+
+void TaskScheduler::submit(uint64_t frame, function<void()> task) {
+	{
+		lock_guard<mutex> lk(m_);
+		++pending_[frame];
+	}
+	push(Task{frame, move(task)});
+}
+
+void TaskScheduler::after(cl::Event done, uint64_t frame,
+		function<void()> task) {
+	{
+		lock_guard<mutex> lk(m_);
+		++pending_[frame];
+	}
+	Continuation* c = new Continuation{this, Task{frame, move(task)}};
+	try {
+		done.setCallback(CL_COMPLETE, eventDone, c);
+	} catch (cl::Error error) {
+		cerr << "Task callback: " << error.err() << endl;
+		done.wait();
+		push(move(c->task));
+		delete c;
+	}
+}
+
+void CL_CALLBACK TaskScheduler::eventDone(cl_event, cl_int, void* data) {
+	// a CL runtime thread: only hand the task to a worker
+	unique_ptr<Continuation> c(static_cast<Continuation*>(data));
+	c->scheduler->push(move(c->task));
+}
+
+void TaskScheduler::push(Task task) {
+	size_t w = currentScheduler == this && currentWorker >= 0
+		? size_t(currentWorker) : nextWorker_++ % workers_.size();
+	{
+		lock_guard<mutex> lk(workers_[w]->m);
+		workers_[w]->tasks.push_back(move(task));
+	}
+	// notified under the lock: from a CL callback, the task may run and
+	// the scheduler be destroyed as soon as it is unlocked
+	lock_guard<mutex> lk(m_);
+	++queued_;
+	work_.notify_one();
+}
+
+bool TaskScheduler::take(Task& task) {
+	size_t n = workers_.size();
+	size_t self = currentScheduler == this && currentWorker >= 0
+		? size_t(currentWorker) : n;
+	if (self < n) {
+		Worker& w = *workers_[self];
+		lock_guard<mutex> lk(w.m);
+		if (!w.tasks.empty()) {
+			task = move(w.tasks.back());
+			w.tasks.pop_back();
+			--queued_;
+			return true;
+		}
+	}
+	// the oldest task of another worker, starting past our own deque
+	size_t start = self < n ? self + 1 : nextWorker_.load();
+	for (size_t k = 0; k < n; ++k) {
+		size_t v = (start + k) % n;
+		if (v == self) {
+			continue;
+		}
+		Worker& w = *workers_[v];
+		lock_guard<mutex> lk(w.m);
+		if (!w.tasks.empty()) {
+			task = move(w.tasks.front());
+			w.tasks.pop_front();
+			--queued_;
+			if (self < n) {
+				++stolen_;
+			}
+			return true;
+		}
+	}
+	return false;
+}
+
+void TaskScheduler::run(Task& task) {
+	task.run();
+	task.run = nullptr;
+	++executed_;
+	{
+		lock_guard<mutex> lk(m_);
+		auto it = pending_.find(task.frame);
+		if (--it->second == 0) {
+			pending_.erase(it);
+		}
+	}
+	done_.notify_all();
+}
+
+void TaskScheduler::worker(size_t index) {
+	currentWorker = int(index);
+	currentScheduler = this;
+	for (;;) {
+		Task task;
+		if (take(task)) {
+			run(task);
+			continue;
+		}
+		unique_lock<mutex> lk(m_);
+		work_.wait(lk, [this] { return stop_ || queued_ > 0; });
+		if (stop_ && queued_ == 0) {
+			return;
+		}
+	}
+}
+
+void TaskScheduler::parallelFor(uint64_t frame, int count,
+		const function<void(int)>& task) {
+	if (count <= 0) {
+		return;
+	}
+	auto left = make_shared<atomic<int> >(count);
+	for (int i = 0; i < count; ++i) {
+		submit(frame, [this, &task, left, i] {
+			task(i);
+			// run() notifies done_ under m_ right after
+			--*left;
+		});
+	}
+	for (;;) {
+		Task t;
+		if (*left == 0) {
+			return;
+		}
+		if (take(t)) {
+			run(t);
+			continue;
+		}
+		unique_lock<mutex> lk(m_);
+		done_.wait(lk, [&] { return *left == 0 || queued_ > 0; });
+	}
+}
+
+void TaskScheduler::wait(uint64_t frame) {
+	auto finished = [&] {
+		return pending_.empty() || pending_.begin()->first > frame;
+	};
+	for (;;) {
+		{
+			unique_lock<mutex> lk(m_);
+			if (finished()) {
+				return;
+			}
+		}
+		Task t;
+		if (take(t)) {
+			run(t);
+			continue;
+		}
+		unique_lock<mutex> lk(m_);
+		done_.wait(lk, [&] { return finished() || queued_ > 0; });
+	}
+}
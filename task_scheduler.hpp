@@ -0,0 +1,97 @@
+#ifndef TASK_SCHEDULER_HPP
+#define TASK_SCHEDULER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define __CL_ENABLE_EXCEPTIONS
+#include "CL/cl.hpp"
+
+/*
+ * Work-stealing scheduler for host-side work, tagged with the frame it
+ * belongs to.
+ *
+ * Every worker has its own deque: it pushes and pops at the back, idle
+ * workers steal from the front of the others. Tasks submitted from
+ * other threads are dealt out round-robin. The default worker count
+ * leaves two hardware threads to the render and manager threads, which
+ * only run tasks while they wait in parallelFor() or wait().
+ *
+ * after() runs a task once a CL event completed, from the event's
+ * callback, so nothing has to block on the event.
+ */
+class TaskScheduler {
+public:
+	// 0 is the hardware threads minus two, at least one
+	explicit TaskScheduler(unsigned threads = 0);
+	// runs whatever is still queued first
+	~TaskScheduler();
+
+	TaskScheduler(const TaskScheduler&) = delete;
+	TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+	void submit(uint64_t frame, std::function<void()> task);
+	// when done completes, also when it failed
+	void after(cl::Event done, uint64_t frame,
+			std::function<void()> task);
+
+	// task(0) to task(count - 1), returns when all ran; the caller runs
+	// tasks too
+	void parallelFor(uint64_t frame, int count,
+			const std::function<void(int)>& task);
+	// until every task of frame and earlier ran, including after()s
+	void wait(uint64_t frame);
+	void waitAll() { wait(UINT64_MAX); }
+
+	unsigned threads() const { return unsigned(workers_.size()); }
+	uint64_t executed() const { return executed_; }
+	uint64_t stolen() const { return stolen_; }
+
+private:
+	struct Task {
+		uint64_t frame;
+		std::function<void()> run;
+	};
+	struct Worker {
+		std::mutex m;
+		std::deque<Task> tasks;
+		std::thread thread;
+	};
+	struct Continuation {
+		TaskScheduler* scheduler;
+		Task task;
+	};
+
+	static void CL_CALLBACK eventDone(cl_event, cl_int, void* data);
+
+	// queues an already counted task
+	void push(Task task);
+	// own deque first, then steals; false when everything is empty
+	bool take(Task& task);
+	void run(Task& task);
+	void worker(size_t index);
+
+	std::vector<std::unique_ptr<Worker> > workers_;
+	std::atomic<size_t> nextWorker_{0};
+	std::atomic<int> queued_{0};
+
+	std::mutex m_;
+	std::condition_variable work_;
+	std::condition_variable done_;
+	// frame -> tasks submitted and not finished yet
+	std::map<uint64_t, int> pending_;
+	bool stop_ = false;
+
+	std::atomic<uint64_t> executed_{0};
+	std::atomic<uint64_t> stolen_{0};
+};
+
+#endif